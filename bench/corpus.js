@@ -0,0 +1,68 @@
+// Generates a synthetic JavaScript corpus for the benchmarks, so that runs are
+// repeatable without checking large files into the repo. The same seed always
+// produces the same source.
+
+function random(seed) {
+  let state = seed >>> 0;
+  return () => {
+    state = (state + 0x6D2B79F5) >>> 0;
+    let t = state;
+    t = Math.imul(t ^ (t >>> 15), t | 1);
+    t ^= t + Math.imul(t ^ (t >>> 7), t | 61);
+    return ((t ^ (t >>> 14)) >>> 0) / 4294967296;
+  };
+}
+
+const WORDS = [
+  'value', 'item', 'count', 'index', 'result', 'node', 'child', 'list',
+  'name', 'options', 'buffer', 'offset', 'state', 'next', 'cache', 'entry'
+];
+
+function generate(targetBytes, seed = 1) {
+  const next = random(seed);
+  const pick = array => array[Math.floor(next() * array.length)];
+  const identifier = () => pick(WORDS) + (next() < 0.5 ? '' : Math.floor(next() * 100));
+
+  function expression(depth) {
+    const r = next();
+    if (depth > 2 || r < 0.3) return identifier();
+    if (r < 0.45) return String(Math.floor(next() * 1000));
+    if (r < 0.55) return `'${pick(WORDS)}'`;
+    if (r < 0.75) return `${expression(depth + 1)} ${pick(['+', '-', '*', '&&', '||', '==='])} ${expression(depth + 1)}`;
+    if (r < 0.9) return `${identifier()}.${identifier()}(${expression(depth + 1)})`;
+    return `[${expression(depth + 1)}, ${expression(depth + 1)}]`;
+  }
+
+  function statement(indent, depth) {
+    const r = next();
+    if (depth < 2 && r < 0.15) {
+      return `${indent}if (${expression(0)}) {\n${block(indent + '  ', depth + 1)}${indent}}\n`;
+    }
+    if (depth < 2 && r < 0.25) {
+      return `${indent}for (let i = 0; i < ${identifier()}.length; i++) {\n${block(indent + '  ', depth + 1)}${indent}}\n`;
+    }
+    if (r < 0.6) return `${indent}const ${identifier()} = ${expression(0)};\n`;
+    if (r < 0.8) return `${indent}${identifier()}.${identifier()}(${expression(0)});\n`;
+    return `${indent}${identifier()} = ${expression(0)};\n`;
+  }
+
+  function block(indent, depth) {
+    let result = '';
+    const count = 1 + Math.floor(next() * 4);
+    for (let i = 0; i < count; i++) result += statement(indent, depth);
+    return result;
+  }
+
+  const chunks = [];
+  let length = 0;
+  for (let i = 0; length < targetBytes; i++) {
+    const chunk = `function ${identifier()}_${i}(${identifier()}, ${identifier()}) {\n` +
+      block('  ', 0) +
+      `  return ${expression(0)};\n}\n\n`;
+    chunks.push(chunk);
+    length += chunk.length;
+  }
+  return chunks.join('');
+}
+
+module.exports = {generate};
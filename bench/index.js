@@ -0,0 +1,252 @@
+#!/usr/bin/env node
+
+// Benchmarks for the hot paths of the binding. Run with `npm run bench`, or
+// `node bench [--filter <name>] [--size <bytes>] [--samples <n>] [--out <file>]`.
+// The results are printed as a table and written as JSON, so that runs on
+// different commits can be compared.
+
+const fs = require('fs');
+const path = require('path');
+const {execSync} = require('child_process');
+const Parser = require('..');
+const JavaScript = require('tree-sitter-javascript');
+const corpus = require('./corpus');
+
+const {Query} = Parser;
+
+function parseArgs(argv) {
+  const options = {
+    filter: null,
+    size: 1024 * 1024,
+    samples: 30,
+    out: path.join(__dirname, 'results', 'latest.json'),
+  };
+  for (let i = 0; i < argv.length; i++) {
+    switch (argv[i]) {
+      case '--filter': options.filter = new RegExp(argv[++i]); break;
+      case '--size': options.size = Number(argv[++i]); break;
+      case '--samples': options.samples = Number(argv[++i]); break;
+      case '--out': options.out = argv[++i]; break;
+      default: throw new Error(`Unknown argument ${argv[i]}`);
+    }
+  }
+  return options;
+}
+
+function percentile(sorted, p) {
+  const index = Math.min(sorted.length - 1, Math.ceil(p / 100 * sorted.length) - 1);
+  return sorted[Math.max(0, index)];
+}
+
+// Summarizes samples, in nanoseconds per operation.
+function summarize(samples) {
+  const sorted = samples.slice().sort((a, b) => a - b);
+  const mean = sorted.reduce((sum, x) => sum + x, 0) / sorted.length;
+  return {
+    samples: sorted.length,
+    mean,
+    min: sorted[0],
+    p50: percentile(sorted, 50),
+    p90: percentile(sorted, 90),
+    p99: percentile(sorted, 99),
+    max: sorted[sorted.length - 1],
+  };
+}
+
+// Runs `fn` for the given number of samples after a few warmup runs. `fn`
+// returns the number of operations that it performed, so that each sample is
+// the time per operation. `setup` runs untimed before each run, and its result
+// is passed to `fn`.
+function measure(fn, samples, setup = () => {}, warmup = 3) {
+  for (let i = 0; i < warmup; i++) fn(setup());
+  const times = [];
+  for (let i = 0; i < samples; i++) {
+    const input = setup();
+    const start = process.hrtime.bigint();
+    const operations = fn(input);
+    times.push(Number(process.hrtime.bigint() - start) / operations);
+  }
+  return summarize(times);
+}
+
+function collectNodes(tree) {
+  const nodes = [];
+  const cursor = tree.walk();
+  for (;;) {
+    nodes.push(cursor.currentNode);
+    if (cursor.gotoFirstChild()) continue;
+    while (!cursor.gotoNextSibling()) {
+      if (!cursor.gotoParent()) return nodes;
+    }
+  }
+}
+
+function scenarios(source, samples) {
+  const parser = new Parser();
+  parser.setLanguage(JavaScript);
+  const tree = parser.parse(source);
+  const bytes = Buffer.byteLength(source);
+
+  const query = new Query(JavaScript, `
+    (function_declaration name: (identifier) @function)
+    (call_expression function: (member_expression property: (property_identifier) @method))
+    (number) @number
+  `);
+
+  return {
+    'parse': () => {
+      const result = measure(() => (parser.parse(source), 1), samples);
+      return {...result, bytes, mbPerSecond: bytes / result.p50 * 1e9 / (1024 * 1024)};
+    },
+
+    'reparse': () => {
+      // Inserts a space at the start of a random line and reparses, keeping
+      // the edited tree for the next edit.
+      const lineStarts = [0];
+      for (let i = 0; i < source.length; i++) {
+        if (source[i] === '\n') lineStarts.push(i + 1);
+      }
+      let current = source;
+      let currentTree = parser.parse(current);
+      let seed = 1;
+      const setup = () => {
+        seed = (seed * 1103515245 + 12345) % 2147483648;
+        const row = seed % lineStarts.length;
+        const index = lineStarts[row];
+        for (let i = row + 1; i < lineStarts.length; i++) lineStarts[i]++;
+        current = current.slice(0, index) + ' ' + current.slice(index);
+        return {index, row};
+      };
+      return measure(({index, row}) => {
+        currentTree.edit({
+          startIndex: index,
+          oldEndIndex: index,
+          newEndIndex: index + 1,
+          startPosition: {row, column: 0},
+          oldEndPosition: {row, column: 0},
+          newEndPosition: {row, column: 1},
+        });
+        currentTree = parser.parse(current, currentTree);
+        return 1;
+      }, samples * 10, setup);
+    },
+
+    'query.matches': () => {
+      let count = 0;
+      const result = measure(() => (count = query.matches(tree.rootNode).length, 1), samples);
+      return {...result, matches: count, matchesPerSecond: count / result.p50 * 1e9};
+    },
+
+    'query.captures': () => {
+      let count = 0;
+      const result = measure(() => (count = query.captures(tree.rootNode).length, 1), samples);
+      return {...result, captures: count, capturesPerSecond: count / result.p50 * 1e9};
+    },
+
+    'cursor traversal': () => {
+      const cursor = tree.walk();
+      const result = measure(() => {
+        let count = 1;
+        cursor.reset(tree.rootNode);
+        for (;;) {
+          if (cursor.gotoFirstChild()) { count++; continue; }
+          while (!cursor.gotoNextSibling()) {
+            if (!cursor.gotoParent()) return count;
+          }
+          count++;
+        }
+      }, samples);
+      return {...result, nodesPerSecond: 1e9 / result.p50};
+    },
+
+    'children traversal': () => {
+      const result = measure(() => {
+        let count = 0;
+        const stack = [tree.rootNode];
+        while (stack.length) {
+          const node = stack.pop();
+          count++;
+          for (const child of node.children) stack.push(child);
+        }
+        return count;
+      }, samples);
+      return {...result, nodesPerSecond: 1e9 / result.p50};
+    },
+
+    // marshalNode and unmarshalNode are private, so they're measured through
+    // the cheapest accessors that use them: `startPosition` only marshals the
+    // node, and `parent` also unmarshals the result.
+    'marshalNode': () => {
+      const nodes = collectNodes(tree);
+      return measure(() => {
+        for (const node of nodes) node.startPosition;
+        return nodes.length;
+      }, samples);
+    },
+
+    // `childCount` passes the node's fields straight to a native method,
+    // which can be a Fast API call, without going through marshalNode.
+    'fastGetter': () => {
+      const nodes = collectNodes(tree);
+      return measure(() => {
+        for (const node of nodes) node.childCount;
+        return nodes.length;
+      }, samples);
+    },
+
+    'unmarshalNode': () => {
+      const nodes = collectNodes(tree);
+      return measure(() => {
+        for (const node of nodes) node.parent;
+        return nodes.length;
+      }, samples);
+    },
+  };
+}
+
+function gitCommit() {
+  try {
+    return execSync('git rev-parse HEAD', {cwd: __dirname, stdio: ['ignore', 'pipe', 'ignore']})
+      .toString().trim();
+  } catch (e) {
+    return null;
+  }
+}
+
+function formatTime(ns) {
+  if (ns >= 1e6) return `${(ns / 1e6).toFixed(2)}ms`;
+  if (ns >= 1e3) return `${(ns / 1e3).toFixed(2)}µs`;
+  return `${ns.toFixed(0)}ns`;
+}
+
+function main() {
+  const options = parseArgs(process.argv.slice(2));
+  const source = corpus.generate(options.size);
+  const results = {};
+
+  for (const [name, run] of Object.entries(scenarios(source, options.samples))) {
+    if (options.filter && !options.filter.test(name)) continue;
+    const result = run();
+    results[name] = result;
+    console.log(
+      name.padEnd(20),
+      ['p50', 'p90', 'p99'].map(p => `${p} ${formatTime(result[p])}`.padEnd(16)).join(''),
+      result.mbPerSecond ? `${result.mbPerSecond.toFixed(2)} MB/s` : ''
+    );
+  }
+
+  const report = {
+    commit: gitCommit(),
+    date: new Date().toISOString(),
+    node: process.version,
+    platform: `${process.platform}-${process.arch}`,
+    corpusBytes: Buffer.byteLength(source),
+    unit: 'ns/op',
+    results,
+  };
+  fs.mkdirSync(path.dirname(options.out), {recursive: true});
+  fs.writeFileSync(options.out, JSON.stringify(report, null, 2) + '\n');
+  console.log(`\nWrote ${options.out}`);
+}
+
+main();
@@ -4,13 +4,17 @@
       "target_name": "tree_sitter_runtime_binding",
       "dependencies": ["tree_sitter"],
       "sources": [
+        "src/addon_data.cc",
         "src/binding.cc",
         "src/conversions.cc",
+        "src/flat_tree.cc",
         "src/language.cc",
         "src/logger.cc",
         "src/node.cc",
         "src/parser.cc",
         "src/query.cc",
+        "src/query_cursor.cc",
+        "src/selector.cc",
         "src/tree.cc",
         "src/tree_cursor.cc",
         "src/util.cc",
@@ -25,12 +29,16 @@
       'cflags_cc': [
         '-std=c++17'
       ],
+      # std::regex, used for `#match?` predicates, reports errors by throwing.
+      'cflags!': ['-fno-exceptions'],
+      'cflags_cc!': ['-fno-exceptions'],
       'conditions': [
         ['OS=="mac"', {
           'xcode_settings': {
             'MACOSX_DEPLOYMENT_TARGET': '10.9',
             'CLANG_CXX_LANGUAGE_STANDARD': 'c++17',
             'CLANG_CXX_LIBRARY': 'libc++',
+            'GCC_ENABLE_CPP_EXCEPTIONS': 'YES',
           },
         }],
         ['OS=="win"', {
@@ -40,6 +48,7 @@
                 '/std:c++17',
               ],
               'RuntimeLibrary': 0,
+              'ExceptionHandling': 1,
             },
           },
         }],
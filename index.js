@@ -10,13 +10,14 @@ try {
 }
 
 const util = require('util')
-const {Query, Parser, NodeMethods, Tree, TreeCursor} = binding;
+const os = require('os')
+const {Query, QueryCursor, Parser, NodeMethods, Tree, TreeCursor, Selector} = binding;
 
 /*
  * Tree
  */
 
-const {rootNode, edit} = Tree.prototype;
+const {rootNode, edit, editMany, _traverse, _parseStats} = Tree.prototype;
 
 Object.defineProperty(Tree.prototype, 'rootNode', {
   get() {
@@ -39,7 +40,16 @@ Object.defineProperty(Tree.prototype, 'rootNode', {
   configurable: true 
 });
 
-Tree.prototype.edit = function(arg) {
+Object.defineProperty(Tree.prototype, 'parseStats', {
+  get() {
+    if (this instanceof Tree && _parseStats) {
+      return _parseStats.call(this);
+    }
+  },
+  configurable: true
+});
+
+Tree.prototype.edit = function(arg, newText) {
   if (this instanceof Tree && edit) {
     edit.call(
       this,
@@ -48,15 +58,158 @@ Tree.prototype.edit = function(arg) {
       arg.newEndPosition.row, arg.newEndPosition.column,
       arg.startIndex,
       arg.oldEndIndex,
-      arg.newEndIndex
+      arg.newEndIndex,
+      newText
     );
+    if (newText == null) this.hasText = false;
   }
 };
 
+Tree.prototype.editMany = function(edits, newTexts) {
+  if (this instanceof Tree && editMany) {
+    editMany.call(this, edits, newTexts);
+    if (newTexts == null || newTexts.some(text => text == null)) this.hasText = false;
+  }
+  return this;
+};
+
+/*
+ * The number of entries per edit in the array passed to `editMany`: the
+ * start, old end and new end index, followed by the row and column of the
+ * start, old end and new end positions.
+ */
+Tree.EDIT_STRIDE = 9;
+
+function packEdits(edits) {
+  const result = new Int32Array(edits.length * Tree.EDIT_STRIDE);
+  edits.forEach((edit, i) => {
+    result.set([
+      edit.startIndex, edit.oldEndIndex, edit.newEndIndex,
+      edit.startPosition.row, edit.startPosition.column,
+      edit.oldEndPosition.row, edit.oldEndPosition.column,
+      edit.newEndPosition.row, edit.newEndPosition.column,
+    ], i * Tree.EDIT_STRIDE);
+  });
+  return result;
+}
+
+/*
+ * Bits of the `flags` column returned by `toFlatArrays`. Missing parents,
+ * children and siblings are represented by `0xFFFFFFFF`.
+ */
+Tree.FLAT_NODE_FLAGS = Object.freeze({
+  NAMED: 1 << 0,
+  ERROR: 1 << 1,
+  MISSING: 1 << 2,
+  EXTRA: 1 << 3,
+  HAS_ERROR: 1 << 4,
+});
+
 Tree.prototype.walk = function() {
   return this.rootNode.walk()
 };
 
+const TRAVERSAL_ENTER = 0;
+const TRAVERSAL_BATCH_SIZE = 256;
+
+Tree.prototype.traverse = function({
+  enter,
+  leave,
+  types,
+  namedOnly = false,
+  maxDepth = 0xFFFFFFFF,
+  batchSize = TRAVERSAL_BATCH_SIZE
+} = {}) {
+  const typeSet = types ? resolveNodeTypeSet(this.language, types) : null;
+
+  _traverse.call(this, typeSet, namedOnly, maxDepth, !!leave, batchSize, (events, nodes) => {
+    unmarshalNodes(nodes, this);
+    for (let i = 0, n = nodes.length; i < n; i++) {
+      const depth = events[2 * i + 1];
+      if (events[2 * i] === TRAVERSAL_ENTER) {
+        if (enter) enter(nodes[i], depth);
+      } else {
+        leave(nodes[i], depth);
+      }
+    }
+  });
+};
+
+// Returns a bitset of the symbols whose names are in `types`. A name can
+// belong to several symbols, when a grammar uses aliases.
+function buildNodeTypeSet(language, types) {
+  const idsByName = getNodeTypeIdsByName(language);
+  const includesError = types.includes(ERROR_TYPE_NAME);
+  const typeCount = includesError ? ERROR_TYPE_ID + 1 : getAllNodeTypeNames(language).length;
+  const typeSet = new Uint8Array((typeCount + 7) >> 3);
+  for (let i = 0, n = types.length; i < n; i++) {
+    const ids = idsByName.get(String(types[i]));
+    if (!ids) continue;
+    for (const id of ids) typeSet[id >> 3] |= 1 << (id & 7);
+  }
+  if (includesError) typeSet[ERROR_TYPE_ID >> 3] |= 1 << (ERROR_TYPE_ID & 7);
+  return typeSet;
+}
+
+// Returns the bitset for a type name, an array of type names, or a
+// precompiled NodeTypeSet of the same language.
+function resolveNodeTypeSet(language, types) {
+  if (types instanceof NodeTypeSet) {
+    if (types.language !== language) {
+      throw new Error('Type set belongs to a different language');
+    }
+    return types.bits;
+  }
+  if (typeof types === 'string') types = [types];
+  if (!Array.isArray(types)) {
+    throw new TypeError('Argument must be a string or array of strings');
+  }
+  return buildNodeTypeSet(language, types);
+}
+
+/*
+ * NodeTypeSet
+ */
+
+// A set of node types that is resolved to symbols once, for passing to
+// `descendantsOfType`, `closest`, `traverse` and `collect` many times.
+class NodeTypeSet {
+  constructor(language, types) {
+    if (typeof types === 'string') types = [types];
+    if (!Array.isArray(types)) {
+      throw new TypeError('Argument must be a string or array of strings');
+    }
+    this.language = language;
+    this.bits = buildNodeTypeSet(language, types);
+    Object.freeze(this);
+  }
+
+  has(typeId) {
+    const byte = typeId >> 3;
+    return byte < this.bits.length && (this.bits[byte] & (1 << (typeId & 7))) !== 0;
+  }
+}
+
+/*
+ * Selector
+ */
+
+const SELECTOR_CACHE_SIZE = 256;
+
+// Returns a compiled Selector, compiling selector strings once per language.
+function compileSelector(language, selector) {
+  if (selector instanceof Selector) return selector;
+  if (!language.selectorCache) language.selectorCache = new Map();
+  const cache = language.selectorCache;
+  let result = cache.get(selector);
+  if (!result) {
+    result = new Selector(language, selector);
+    if (cache.size >= SELECTOR_CACHE_SIZE) cache.clear();
+    cache.set(selector, result);
+  }
+  return result;
+}
+
 /*
  * Node
  */
@@ -81,16 +234,18 @@ class SyntaxNode {
   }
 
   get typeId() {
-    marshalNode(this);
-    return NodeMethods.typeId(this.tree);
+    return this.tree._nodeTypeId(this[0], this[1], this[2], this[3], this[4], this[5], this[6]);
   }
 
   get isNamed() {
-    marshalNode(this);
-    return NodeMethods.isNamed(this.tree);
+    return this.tree._nodeIsNamed(this[0], this[1], this[2], this[3], this[4], this[5], this[6]);
   }
 
   get text() {
+    if (this.tree.hasText) {
+      marshalNode(this);
+      return NodeMethods.text(this.tree);
+    }
     return this.tree.getText(this);
   }
 
@@ -107,13 +262,11 @@ class SyntaxNode {
   }
 
   get startIndex() {
-    marshalNode(this);
-    return NodeMethods.startIndex(this.tree);
+    return this.tree._nodeStartIndex(this[0], this[1], this[2], this[3], this[4], this[5], this[6]);
   }
 
   get endIndex() {
-    marshalNode(this);
-    return NodeMethods.endIndex(this.tree);
+    return this.tree._nodeEndIndex(this[0], this[1], this[2], this[3], this[4], this[5], this[6]);
   }
 
   get parent() {
@@ -132,13 +285,11 @@ class SyntaxNode {
   }
 
   get childCount() {
-    marshalNode(this);
-    return NodeMethods.childCount(this.tree);
+    return this.tree._nodeChildCount(this[0], this[1], this[2], this[3], this[4], this[5], this[6]);
   }
 
   get namedChildCount() {
-    marshalNode(this);
-    return NodeMethods.namedChildCount(this.tree);
+    return this.tree._nodeNamedChildCount(this[0], this[1], this[2], this[3], this[4], this[5], this[6]);
   }
 
   get firstChild() {
@@ -182,18 +333,15 @@ class SyntaxNode {
   }
 
   hasChanges() {
-    marshalNode(this);
-    return NodeMethods.hasChanges(this.tree);
+    return this.tree._nodeHasChanges(this[0], this[1], this[2], this[3], this[4], this[5], this[6]);
   }
 
   hasError() {
-    marshalNode(this);
-    return NodeMethods.hasError(this.tree);
+    return this.tree._nodeHasError(this[0], this[1], this[2], this[3], this[4], this[5], this[6]);
   }
 
   isMissing() {
-    marshalNode(this);
-    return NodeMethods.isMissing(this.tree);
+    return this.tree._nodeIsMissing(this[0], this[1], this[2], this[3], this[4], this[5], this[6]);
   }
 
   toString() {
@@ -235,8 +383,8 @@ class SyntaxNode {
 
   descendantsOfType(types, start, end) {
     marshalNode(this);
-    if (typeof types === 'string') types = [types]
-    return unmarshalNodes(NodeMethods.descendantsOfType(this.tree, types, start, end), this.tree);
+    const typeSet = resolveNodeTypeSet(this.tree.language, types);
+    return unmarshalNodes(NodeMethods.descendantsOfType(this.tree, typeSet, start, end), this.tree);
   }
 
   namedDescendantForPosition(start, end) {
@@ -253,8 +401,21 @@ class SyntaxNode {
 
   closest(types) {
     marshalNode(this);
-    if (typeof types === 'string') types = [types]
-    return unmarshalNode(NodeMethods.closest(this.tree, types), this.tree);
+    const typeSet = resolveNodeTypeSet(this.tree.language, types);
+    return unmarshalNode(NodeMethods.closest(this.tree, typeSet), this.tree);
+  }
+
+  select(selector) {
+    marshalNode(this);
+    selector = compileSelector(this.tree.language, selector);
+    return unmarshalNodes(NodeMethods.select(this.tree, selector, 0), this.tree);
+  }
+
+  selectFirst(selector) {
+    marshalNode(this);
+    selector = compileSelector(this.tree.language, selector);
+    const nodes = NodeMethods.select(this.tree, selector, 1);
+    return nodes.length > 0 ? unmarshalNodes(nodes, this.tree)[0] : null;
   }
 
   walk () {
@@ -269,7 +430,8 @@ class SyntaxNode {
  * Parser
  */
 
-const {parse, setLanguage} = Parser.prototype;
+const {parse, parseAsync, _reparse, _setLogBuffer, _drainLog, setLanguage} = Parser.prototype;
+const {parseMany} = Parser;
 const languageSymbol = Symbol('parser.language');
 
 Parser.prototype.setLanguage = function(language) {
@@ -287,37 +449,167 @@ Parser.prototype.getLanguage = function(language) {
   return this[languageSymbol] || null;
 };
 
-Parser.prototype.parse = function(input, oldTree, {bufferSize, includedRanges}={}) {
-  let getText, treeInput = input
-  if (typeof input === 'string') {
-    const inputString = input;
-    input = (offset, position) => inputString.slice(offset)
-    getText = getTextFromString
-  } else {
-    getText = getTextFromFunction
-  }
+Parser.prototype.parse = function(input, oldTree, {bufferSize, includedRanges, encoding, timeoutMicros, cancellationFlag, keepText = false}={}) {
   const tree = this instanceof Parser && parse
     ? parse.call(
       this,
       input,
       oldTree,
       bufferSize,
-      includedRanges)
+      includedRanges,
+      encoding,
+      timeoutMicros,
+      cancellationFlag,
+      keepText)
     : undefined;
 
+  return initializeTree(tree, input, this.getLanguage(), keepText)
+};
+
+Parser.prototype.parseAsync = function(input, oldTree, {bufferSize, includedRanges, encoding, timeoutMicros, cancellationFlag, keepText = false}={}) {
+  const language = this.getLanguage();
+  return new Promise((resolve, reject) => {
+    parseAsync.call(
+      this,
+      input,
+      oldTree,
+      bufferSize,
+      includedRanges,
+      encoding,
+      timeoutMicros,
+      cancellationFlag,
+      (error, tree) => {
+        if (error) {
+          reject(error);
+        } else {
+          resolve(initializeTree(tree, input, language, keepText));
+        }
+      },
+      keepText
+    );
+  });
+};
+
+const LOG_TYPES = ['parse', 'lex'];
+const LOG_RECORD_HEADER_LENGTH = 3;
+
+Parser.prototype.setLogBuffer = function({capacity = 1024 * 1024, types = LOG_TYPES, sampleInterval = 1} = {}) {
+  _setLogBuffer.call(this, capacity, types.includes('parse'), types.includes('lex'), sampleInterval);
+  return this;
+};
+
+Parser.prototype.drainLog = function({raw = false} = {}) {
+  const records = _drainLog.call(this);
+  if (!records || raw) return records;
+
+  const result = [];
+  for (let i = 0; i < records.length;) {
+    const end = i + LOG_RECORD_HEADER_LENGTH + records.readUInt16LE(i + 1);
+    result.push({type: LOG_TYPES[records[i]], message: records.toString('utf8', i + LOG_RECORD_HEADER_LENGTH, end)});
+    i = end;
+  }
+  return result;
+};
+
+/*
+ * The number of entries per range in the `changedRanges` returned by
+ * `reparse`: the start and end index, followed by the row and column of the
+ * start and end positions.
+ */
+Parser.CHANGED_RANGE_STRIDE = 6;
+
+Parser.prototype.reparse = function(tree, edits, input, {bufferSize, includedRanges, encoding, timeoutMicros, cancellationFlag, keepText = false}={}) {
+  if (Array.isArray(edits)) edits = packEdits(edits);
+  let result = null;
+  try {
+    if (this instanceof Parser && _reparse) {
+      result = _reparse.call(
+        this,
+        tree,
+        edits,
+        input,
+        bufferSize,
+        includedRanges,
+        encoding,
+        timeoutMicros,
+        cancellationFlag,
+        keepText);
+    }
+  } finally {
+    // A halted parse throws after the tree has been edited.
+    if (tree) tree.hasText = false;
+  }
+  if (!result) return null;
+
+  return {
+    tree: initializeTree(result[0], input, this.getLanguage(), keepText),
+    changedRanges: result[1]
+  };
+};
+
+// Each worker holds a libuv thread pool thread for the whole batch, so by
+// default one thread of the pool is left for other work, such as `fs`.
+function defaultParseManyConcurrency() {
+  const threadPoolSize = Number(process.env.UV_THREADPOOL_SIZE) || 4;
+  return Math.max(1, Math.min(os.cpus().length, threadPoolSize - 1));
+}
+
+Parser.parseMany = function(jobs, {concurrency = defaultParseManyConcurrency(), timeoutMicros, onFile}={}) {
+  for (const job of jobs) {
+    if (job) defineLanguageTypeSet(job.language);
+  }
+  return new Promise((resolve, reject) => {
+    const trees = new Array(jobs.length).fill(null);
+    let callbackError = null;
+    parseMany.call(
+      this,
+      jobs,
+      concurrency,
+      timeoutMicros,
+      (index, error, tree) => {
+        const {input, language} = jobs[index];
+        if (tree) trees[index] = initializeTree(tree, input, language);
+        if (onFile && !callbackError) {
+          try {
+            onFile(index, error, trees[index]);
+          } catch (e) {
+            callbackError = e;
+          }
+        }
+      },
+      () => callbackError ? reject(callbackError) : resolve(trees)
+    );
+  });
+};
+
+function initializeTree(tree, input, language, keepText = false) {
   if (tree) {
-    tree.input = treeInput
-    tree.getText = getText
-    tree.language = this.getLanguage()
+    tree.hasText = keepText
+    if (typeof input === 'string') {
+      tree.input = input
+      tree.getText = getTextFromString
+    } else if (typeof input === 'function') {
+      tree.input = input
+      tree.getText = getTextFromFunction
+    } else {
+      tree.input = Buffer.isBuffer(input)
+        ? input
+        : Buffer.from(input.buffer, input.byteOffset, input.byteLength)
+      tree.getText = getTextFromBuffer
+    }
+    tree.language = language
+    if (language && !language.nodeSubclasses) {
+      initializeLanguageNodeClasses(language)
+    }
   }
   return tree
-};
+}
 
 /*
  * TreeCursor
  */
 
-const {startPosition, endPosition, currentNode, reset} = TreeCursor.prototype;
+const {startPosition, endPosition, currentNode, reset, resetTo, _collect} = TreeCursor.prototype;
 
 Object.defineProperties(TreeCursor.prototype, {
   currentNode: {
@@ -348,6 +640,7 @@ Object.defineProperties(TreeCursor.prototype, {
   },
   nodeText: {
     get() {
+      if (this.tree.hasText) return this.tree.getTextRange(this.startIndex, this.endIndex);
       return this.tree.getText(this)
     },
     configurable: true
@@ -361,11 +654,31 @@ TreeCursor.prototype.reset = function(node) {
   }
 }
 
+TreeCursor.prototype.resetTo = function(cursor) {
+  if (this instanceof TreeCursor && resetTo) {
+    resetTo.call(this, cursor);
+    this.tree = cursor.tree;
+  }
+}
+
+/*
+ * Returns the next `maxNodes` nodes in pre-order that pass the filter, as a
+ * flat Uint32Array with `TreeCursor.COLLECT_STRIDE` entries per node: the
+ * depth below the cursor's root, the type id, the field id, and the start
+ * and end index. Fewer nodes are returned once the walk is finished.
+ */
+TreeCursor.COLLECT_STRIDE = 5;
+
+TreeCursor.prototype.collect = function(maxNodes, {types, namedOnly = false} = {}) {
+  const typeSet = types ? resolveNodeTypeSet(this.tree.language, types) : null;
+  return _collect.call(this, maxNodes, typeSet, namedOnly);
+}
+
 /*
  * Query
  */
 
-const {_matches, _captures} = Query.prototype;
+const {_matches, _captures, _iterMatches, _rawCaptures} = Query.prototype;
 
 const PREDICATE_STEP_TYPE = {
   DONE: 0,
@@ -375,10 +688,17 @@ const PREDICATE_STEP_TYPE = {
 
 const ZERO_POINT = { row: 0, column: 0 };
 
-Query.prototype._init = function() {
+Query.prototype._init = function(language) {
+  defineLanguageTypeSet(language);
+
   /*
    * Initialize predicate functions
    * format: [type1, value1, type2, value2, ...]
+   *
+   * `#eq?`, `#not-eq?` and `#match?` predicates are normally evaluated
+   * natively, and only reach this point when they can't be. Only `#match?`
+   * patterns that are literal strings, optionally anchored with `^` or `$`,
+   * are evaluated natively; every other pattern is a JavaScript RegExp.
    */
   const predicateDescriptions = this._getPredicates();
   const patternCount = predicateDescriptions.length;
@@ -494,6 +814,7 @@ Query.prototype._init = function() {
     }
   }
 
+  this.captureNames = Object.freeze(this._getCaptureNames());
   this.predicates = Object.freeze(predicates);
   this.setProperties = Object.freeze(setProperties);
   this.assertedProperties = Object.freeze(assertedProperties);
@@ -504,9 +825,66 @@ Query.prototype.matches = function(rootNode, startPosition = ZERO_POINT, endPosi
   marshalNode(rootNode);
   const [returnedMatches, returnedNodes] = _matches.call(this, rootNode.tree,
     startPosition.row, startPosition.column,
-    endPosition.row, endPosition.column
+    endPosition.row, endPosition.column,
+    rootNode.tree.input
   );
-  const nodes = unmarshalNodes(returnedNodes, rootNode.tree);
+  return buildMatches(this, returnedMatches, unmarshalNodes(returnedNodes, rootNode.tree));
+}
+
+/*
+ * Returns the captures as a flat Uint32Array, with `Query.RAW_CAPTURE_STRIDE`
+ * entries per capture: the pattern index, the capture id (an index into
+ * `captureNames`), the start and end index, and the two words of the node's
+ * id. Only predicates that are evaluated natively are supported, so
+ * `#match?` patterns must be literal strings, optionally anchored.
+ */
+Query.RAW_CAPTURE_STRIDE = 6;
+
+Query.prototype.rawCaptures = function(rootNode, {startIndex, endIndex} = {}) {
+  if (this.predicates.some(p => p.length > 0)) {
+    throw new Error('rawCaptures does not support predicates that are evaluated in JavaScript');
+  }
+  marshalNode(rootNode);
+  return _rawCaptures.call(this, rootNode.tree, startIndex, endIndex, rootNode.tree.input);
+}
+
+Query.prototype.iterMatches = function(rootNode, {startIndex, endIndex, matchLimit, batchSize = 64} = {}) {
+  marshalNode(rootNode);
+  const cursor = _iterMatches.call(this, rootNode.tree, startIndex, endIndex, matchLimit);
+  return new QueryMatchIterator(this, cursor, rootNode.tree, batchSize);
+}
+
+class QueryMatchIterator {
+  constructor(query, cursor, tree, batchSize) {
+    this.query = query;
+    this.cursor = cursor;
+    this.tree = tree;
+    this.batchSize = batchSize;
+    this.batch = [];
+    this.batchIndex = 0;
+  }
+
+  get didExceedMatchLimit() {
+    return this.cursor.didExceedMatchLimit;
+  }
+
+  next() {
+    while (this.batchIndex === this.batch.length) {
+      const result = this.cursor._nextMatches(this.batchSize, this.tree.input);
+      if (!result) return {done: true, value: undefined};
+      const [returnedMatches, returnedNodes] = result;
+      this.batch = buildMatches(this.query, returnedMatches, unmarshalNodes(returnedNodes, this.tree));
+      this.batchIndex = 0;
+    }
+    return {done: false, value: this.batch[this.batchIndex++]};
+  }
+
+  [Symbol.iterator]() {
+    return this;
+  }
+}
+
+function buildMatches(query, returnedMatches, nodes) {
   const results = [];
 
   let i = 0
@@ -523,11 +901,11 @@ Query.prototype.matches = function(rootNode, startPosition = ZERO_POINT, endPosi
       })
     }
 
-    if (this.predicates[patternIndex].every(p => p(captures))) {
+    if (query.predicates[patternIndex].every(p => p(captures))) {
       const result = {pattern: patternIndex, captures};
-      const setProperties = this.setProperties[patternIndex];
-      const assertedProperties = this.assertedProperties[patternIndex];
-      const refutedProperties = this.refutedProperties[patternIndex];
+      const setProperties = query.setProperties[patternIndex];
+      const assertedProperties = query.assertedProperties[patternIndex];
+      const refutedProperties = query.refutedProperties[patternIndex];
       if (setProperties) result.setProperties = setProperties;
       if (assertedProperties) result.assertedProperties = assertedProperties;
       if (refutedProperties) result.refutedProperties = refutedProperties;
@@ -542,7 +920,8 @@ Query.prototype.captures = function(rootNode, startPosition = ZERO_POINT, endPos
   marshalNode(rootNode);
   const [returnedMatches, returnedNodes] = _captures.call(this, rootNode.tree,
     startPosition.row, startPosition.column,
-    endPosition.row, endPosition.column
+    endPosition.row, endPosition.column,
+    rootNode.tree.input
   );
   const nodes = unmarshalNodes(returnedNodes, rootNode.tree);
   const results = [];
@@ -577,6 +956,261 @@ Query.prototype.captures = function(rootNode, startPosition = ZERO_POINT, endPos
   return results;
 }
 
+/*
+ * FlatTree
+ *
+ * A snapshot is a header of 8 words (magic number, format version, encoding,
+ * node count, column count, language ABI version, language fingerprint,
+ * reserved), followed by the columns that `Tree.prototype.toFlatArrays`
+ * returns, in the same order.
+ */
+
+const SNAPSHOT_MAGIC = 0x54535446;
+const SNAPSHOT_FORMAT_VERSION = 1;
+const SNAPSHOT_HEADER_LENGTH = 8;
+const FLAT_TREE_COLUMNS = [
+  'typeId', 'fieldId',
+  'startIndex', 'endIndex',
+  'startRow', 'startColumn', 'endRow', 'endColumn',
+  'parent', 'firstChild', 'nextSibling',
+  'flags',
+];
+const FLAT_NODE_NONE = 0xFFFFFFFF;
+const ERROR_TYPE_NAME = 'ERROR';
+
+Tree.prototype.serialize = function() {
+  return binding.serializeTree(this);
+};
+
+class FlatTree {
+  constructor(buffer, language) {
+    if (!(buffer instanceof Uint8Array)) {
+      throw new TypeError('Snapshot must be a Buffer or Uint8Array');
+    }
+
+    // The columns are read in place, which requires them to be aligned.
+    if (buffer.byteOffset % 4 !== 0) buffer = new Uint8Array(buffer);
+
+    const header = buffer.byteLength >= SNAPSHOT_HEADER_LENGTH * 4
+      ? new Uint32Array(buffer.buffer, buffer.byteOffset, SNAPSHOT_HEADER_LENGTH)
+      : null;
+    if (!header || header[0] !== SNAPSHOT_MAGIC) {
+      throw new Error('Invalid tree snapshot');
+    }
+    if (header[1] !== SNAPSHOT_FORMAT_VERSION || header[4] !== FLAT_TREE_COLUMNS.length) {
+      throw new Error(`Unsupported tree snapshot format version ${header[1]}`);
+    }
+    if (header[6] !== binding.getLanguageFingerprint(language)) {
+      throw new Error('Tree snapshot was written with a different language');
+    }
+
+    const length = header[3];
+    if (buffer.byteLength < (SNAPSHOT_HEADER_LENGTH + length * FLAT_TREE_COLUMNS.length) * 4) {
+      throw new Error('Truncated tree snapshot');
+    }
+
+    this.buffer = buffer;
+    this.language = language;
+    this.encoding = header[2] === 0 ? 'utf8' : 'utf16';
+    this.length = length;
+    FLAT_TREE_COLUMNS.forEach((name, i) => {
+      const byteOffset = buffer.byteOffset + (SNAPSHOT_HEADER_LENGTH + i * length) * 4;
+      this[name] = new Uint32Array(buffer.buffer, byteOffset, length);
+    });
+
+    getAllNodeTypeNames(language);
+    if (!language.flatTreeFieldNames) {
+      language.flatTreeFieldNames = binding.getNodeFieldNamesById(language);
+    }
+  }
+
+  static mapFile(path, language) {
+    return new FlatTree(binding.mapFile(path), language);
+  }
+
+  get rootNode() {
+    return new FlatNode(this, 0);
+  }
+
+  descendantForIndex(startIndex, endIndex = startIndex) {
+    return this.rootNode.descendantForIndex(startIndex, endIndex);
+  }
+
+  namedDescendantForIndex(startIndex, endIndex = startIndex) {
+    return this.rootNode.namedDescendantForIndex(startIndex, endIndex);
+  }
+
+  descendantsOfType(types, startPosition, endPosition) {
+    return this.rootNode.descendantsOfType(types, startPosition, endPosition);
+  }
+
+  _node(index) {
+    return index === FLAT_NODE_NONE ? null : new FlatNode(this, index);
+  }
+
+  _subtreeEnd(index) {
+    for (let i = index; i !== FLAT_NODE_NONE; i = this.parent[i]) {
+      if (this.nextSibling[i] !== FLAT_NODE_NONE) return this.nextSibling[i];
+    }
+    return this.length;
+  }
+}
+
+/*
+ * A read-only node of a FlatTree. Nodes are created on demand, so they
+ * should be compared by `index` rather than by identity.
+ */
+class FlatNode {
+  constructor(tree, index) {
+    this.tree = tree;
+    this.index = index;
+  }
+
+  get typeId() {
+    return this.tree.typeId[this.index];
+  }
+
+  get type() {
+    const {typeId} = this;
+    return this.tree.language.flatTreeTypeNames[typeId] || ERROR_TYPE_NAME;
+  }
+
+  get isNamed() {
+    return (this.tree.flags[this.index] & Tree.FLAT_NODE_FLAGS.NAMED) !== 0;
+  }
+
+  get isMissing() {
+    return (this.tree.flags[this.index] & Tree.FLAT_NODE_FLAGS.MISSING) !== 0;
+  }
+
+  get hasError() {
+    return (this.tree.flags[this.index] & Tree.FLAT_NODE_FLAGS.HAS_ERROR) !== 0;
+  }
+
+  get startIndex() {
+    return this.tree.startIndex[this.index];
+  }
+
+  get endIndex() {
+    return this.tree.endIndex[this.index];
+  }
+
+  get startPosition() {
+    return {row: this.tree.startRow[this.index], column: this.tree.startColumn[this.index]};
+  }
+
+  get endPosition() {
+    return {row: this.tree.endRow[this.index], column: this.tree.endColumn[this.index]};
+  }
+
+  get parent() {
+    return this.tree._node(this.tree.parent[this.index]);
+  }
+
+  get firstChild() {
+    return this.tree._node(this.tree.firstChild[this.index]);
+  }
+
+  get lastChild() {
+    const {children} = this;
+    return children.length > 0 ? children[children.length - 1] : null;
+  }
+
+  get nextSibling() {
+    return this.tree._node(this.tree.nextSibling[this.index]);
+  }
+
+  get previousSibling() {
+    const {parent} = this;
+    if (!parent) return null;
+    let previous = FLAT_NODE_NONE;
+    for (let i = this.tree.firstChild[parent.index]; i !== this.index; i = this.tree.nextSibling[i]) {
+      previous = i;
+    }
+    return this.tree._node(previous);
+  }
+
+  get children() {
+    const result = [];
+    for (let i = this.tree.firstChild[this.index]; i !== FLAT_NODE_NONE; i = this.tree.nextSibling[i]) {
+      result.push(new FlatNode(this.tree, i));
+    }
+    return result;
+  }
+
+  get namedChildren() {
+    return this.children.filter(child => child.isNamed);
+  }
+
+  get childCount() {
+    return this.children.length;
+  }
+
+  get namedChildCount() {
+    return this.namedChildren.length;
+  }
+
+  childrenForFieldName(fieldName) {
+    const fieldId = this.tree.language.flatTreeFieldNames.indexOf(fieldName);
+    if (fieldId <= 0) return [];
+    return this.children.filter(child => this.tree.fieldId[child.index] === fieldId);
+  }
+
+  childForFieldName(fieldName) {
+    return this.childrenForFieldName(fieldName)[0] || null;
+  }
+
+  descendantForIndex(startIndex, endIndex = startIndex) {
+    return this._descendantForRange(startIndex, endIndex, false);
+  }
+
+  namedDescendantForIndex(startIndex, endIndex = startIndex) {
+    return this._descendantForRange(startIndex, endIndex, true);
+  }
+
+  descendantsOfType(types, startPosition, endPosition) {
+    const {tree} = this;
+    const typeSet = resolveNodeTypeSet(tree.language, types);
+
+    const start = startPosition || ZERO_POINT;
+    const end = endPosition || {row: Infinity, column: Infinity};
+    const result = [];
+    for (let i = this.index, n = tree._subtreeEnd(this.index); i < n; i++) {
+      const typeId = tree.typeId[i];
+      if (!(typeSet[typeId >> 3] & (1 << (typeId & 7)))) continue;
+      if (comparePoints(tree.endRow[i], tree.endColumn[i], start) <= 0) continue;
+      if (comparePoints(tree.startRow[i], tree.startColumn[i], end) >= 0) continue;
+      result.push(new FlatNode(tree, i));
+    }
+    return result;
+  }
+
+  _descendantForRange(rangeStart, rangeEnd, named) {
+    const {tree} = this;
+    let node = this.index;
+    let lastVisible = node;
+    let didDescend = true;
+    while (didDescend) {
+      didDescend = false;
+      for (let i = tree.firstChild[node]; i !== FLAT_NODE_NONE; i = tree.nextSibling[i]) {
+        const nodeEnd = tree.endIndex[i];
+        if (nodeEnd < rangeEnd || nodeEnd <= rangeStart) continue;
+        if (rangeStart < tree.startIndex[i]) break;
+        node = i;
+        if (!named || (tree.flags[i] & Tree.FLAT_NODE_FLAGS.NAMED)) lastVisible = i;
+        didDescend = true;
+        break;
+      }
+    }
+    return new FlatNode(tree, lastVisible);
+  }
+}
+
+function comparePoints(row, column, point) {
+  if (row !== point.row) return row - point.row;
+  return column - point.column;
+}
+
 /*
  * Other functions
  */
@@ -585,6 +1219,10 @@ function getTextFromString (node) {
   return this.input.substring(node.startIndex, node.endIndex);
 }
 
+function getTextFromBuffer ({startIndex, endIndex}) {
+  return this.input.toString('utf8', startIndex, endIndex);
+}
+
 function getTextFromFunction ({startIndex, endIndex}) {
   const {input} = this
   let result = '';
@@ -598,7 +1236,7 @@ function getTextFromFunction ({startIndex, endIndex}) {
 
 const {pointTransferArray} = binding;
 
-const NODE_FIELD_COUNT = 6;
+const NODE_FIELD_COUNT = 7;
 const ERROR_TYPE_ID = 0xFFFF
 
 function getID(buffer, offset) {
@@ -678,6 +1316,29 @@ function pointToString(point) {
   return `{row: ${point.row}, column: ${point.column}}`;
 }
 
+function getAllNodeTypeNames(language) {
+  defineLanguageTypeSet(language);
+  if (!language.flatTreeTypeNames) {
+    language.flatTreeTypeNames = binding.getNodeTypeNamesById(language, true);
+  }
+  return language.flatTreeTypeNames;
+}
+
+// Maps each type name of a language to its symbols, built once per language.
+function getNodeTypeIdsByName(language) {
+  if (!language.nodeTypeIdsByName) {
+    const idsByName = new Map();
+    getAllNodeTypeNames(language).forEach((name, id) => {
+      if (name == null) return;
+      const ids = idsByName.get(name);
+      if (ids) ids.push(id);
+      else idsByName.set(name, [id]);
+    });
+    language.nodeTypeIdsByName = idsByName;
+  }
+  return language.nodeTypeIdsByName;
+}
+
 function initializeLanguageNodeClasses(language) {
   const nodeTypeNamesById = binding.getNodeTypeNamesById(language);
   const nodeFieldNamesById = binding.getNodeFieldNamesById(language);
@@ -729,6 +1390,18 @@ function initializeLanguageNodeClasses(language) {
   }
 
   language.nodeSubclasses = nodeSubclasses
+  defineLanguageTypeSet(language);
+}
+
+// Gives a language a `typeSet` method the first time that tree-sitter sees
+// it, whether through a parser, `parseMany`, a query or a type lookup.
+function defineLanguageTypeSet(language) {
+  if (language && typeof language === 'object' && !language.typeSet) {
+    Object.defineProperty(language, 'typeSet', {
+      value(types) { return new NodeTypeSet(this, types); },
+      configurable: true
+    });
+  }
 }
 
 function camelCase(name, upperCase) {
@@ -739,6 +1412,11 @@ function camelCase(name, upperCase) {
 
 module.exports = Parser;
 module.exports.Query = Query;
+module.exports.QueryCursor = QueryCursor;
 module.exports.Tree = Tree;
 module.exports.SyntaxNode = SyntaxNode;
 module.exports.TreeCursor = TreeCursor;
+module.exports.FlatTree = FlatTree;
+module.exports.FlatNode = FlatNode;
+module.exports.NodeTypeSet = NodeTypeSet;
+module.exports.Selector = Selector;
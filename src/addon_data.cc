@@ -0,0 +1,68 @@
+#include "./addon_data.h"
+#include <cstdlib>
+#include <v8.h>
+#include <nan.h>
+#include <tree_sitter/api.h>
+
+namespace node_tree_sitter {
+
+using namespace v8;
+
+// The number of idle cursors that are kept around for reuse.
+static const size_t MAX_IDLE_QUERY_CURSORS = 8;
+
+AddonData::AddonData() {}
+
+AddonData::~AddonData() {
+  // The transfer buffers are only owned by the addon when they were allocated
+  // with malloc; see `setup_transfer_buffer` and `InitConversions`.
+  #if !(defined(_MSC_VER) && NODE_RUNTIME_ELECTRON && NODE_MODULE_VERSION >= 89)
+    free(transfer_buffer);
+    free(point_transfer_buffer);
+  #endif
+
+  ts_tree_cursor_delete(&scratch_cursor);
+  for (TSQueryCursor *cursor : idle_query_cursors) {
+    ts_query_cursor_delete(cursor);
+  }
+
+  language_names.clear();
+  module_exports.Reset();
+  row_key.Reset();
+  column_key.Reset();
+  start_index_key.Reset();
+  start_position_key.Reset();
+  end_index_key.Reset();
+  end_position_key.Reset();
+  parser_constructor.Reset();
+  query_constructor.Reset();
+  query_constructor_template.Reset();
+  query_cursor_constructor.Reset();
+  selector_constructor_template.Reset();
+  tree_constructor.Reset();
+  tree_constructor_template.Reset();
+  tree_cursor_constructor.Reset();
+}
+
+TSQueryCursor *AddonData::AcquireQueryCursor() {
+  if (idle_query_cursors.empty()) return ts_query_cursor_new();
+  TSQueryCursor *cursor = idle_query_cursors.back();
+  idle_query_cursors.pop_back();
+  return cursor;
+}
+
+void AddonData::ReleaseQueryCursor(TSQueryCursor *cursor) {
+  if (idle_query_cursors.size() >= MAX_IDLE_QUERY_CURSORS) {
+    ts_query_cursor_delete(cursor);
+    return;
+  }
+
+  // The ranges and the match limit outlive `ts_query_cursor_exec`, so clear
+  // them for the next user.
+  ts_query_cursor_set_byte_range(cursor, 0, UINT32_MAX);
+  ts_query_cursor_set_point_range(cursor, {0, 0}, {UINT32_MAX, UINT32_MAX});
+  ts_query_cursor_set_match_limit(cursor, UINT32_MAX);
+  idle_query_cursors.push_back(cursor);
+}
+
+}  // namespace node_tree_sitter
@@ -0,0 +1,89 @@
+#ifndef NODE_TREE_SITTER_ADDON_DATA_H_
+#define NODE_TREE_SITTER_ADDON_DATA_H_
+
+#include <v8.h>
+#include <nan.h>
+#include <unordered_map>
+#include <vector>
+#include <tree_sitter/api.h>
+
+namespace node_tree_sitter {
+
+// State belonging to one instance of the addon. Every environment that
+// loads the module (the main thread and each worker thread) gets its own
+// copy, which is passed to the native methods as their callback data and
+// freed when the environment is torn down.
+class AddonData {
+ public:
+  AddonData();
+  ~AddonData();
+
+  // Query cursors are reused across query executions. A cursor that is
+  // acquired belongs to the caller until it is released, so any number of
+  // executions can be in progress at once.
+  TSQueryCursor *AcquireQueryCursor();
+  void ReleaseQueryCursor(TSQueryCursor *);
+
+  // language.cc
+  // Internalized strings for the node type and field names of each language,
+  // indexed by symbol and field id and created when they're first needed.
+  struct LanguageNames {
+    std::vector<Nan::Global<v8::String>> type_names;
+    std::vector<Nan::Global<v8::String>> field_names;
+  };
+  std::unordered_map<const TSLanguage *, LanguageNames> language_names;
+
+  // node.cc
+  uint32_t *transfer_buffer = nullptr;
+  uint32_t transfer_buffer_length = 0;
+  Nan::Persistent<v8::Object> module_exports;
+  TSTreeCursor scratch_cursor = {nullptr, nullptr, {0, 0}};
+
+  // conversions.cc
+  uint32_t *point_transfer_buffer = nullptr;
+  Nan::Persistent<v8::String> row_key;
+  Nan::Persistent<v8::String> column_key;
+  Nan::Persistent<v8::String> start_index_key;
+  Nan::Persistent<v8::String> start_position_key;
+  Nan::Persistent<v8::String> end_index_key;
+  Nan::Persistent<v8::String> end_position_key;
+
+  // parser.cc
+  Nan::Persistent<v8::Function> parser_constructor;
+
+  // query.cc
+  std::vector<TSQueryCursor *> idle_query_cursors;
+  Nan::Persistent<v8::Function> query_constructor;
+  Nan::Persistent<v8::FunctionTemplate> query_constructor_template;
+
+  // selector.cc
+  Nan::Persistent<v8::FunctionTemplate> selector_constructor_template;
+
+  // query_cursor.cc
+  Nan::Persistent<v8::Function> query_cursor_constructor;
+
+  // tree.cc
+  Nan::Persistent<v8::Function> tree_constructor;
+  Nan::Persistent<v8::FunctionTemplate> tree_constructor_template;
+
+  // tree_cursor.cc
+  Nan::Persistent<v8::Function> tree_cursor_constructor;
+};
+
+static inline AddonData *GetAddonData(const v8::Local<v8::Value> &data) {
+  return static_cast<AddonData *>(v8::Local<v8::External>::Cast(data)->Value());
+}
+
+template <typename T>
+static inline AddonData *GetAddonData(const Nan::FunctionCallbackInfo<T> &info) {
+  return GetAddonData(info.Data());
+}
+
+template <typename T>
+static inline AddonData *GetAddonData(const Nan::PropertyCallbackInfo<T> &info) {
+  return GetAddonData(info.Data());
+}
+
+}  // namespace node_tree_sitter
+
+#endif  // NODE_TREE_SITTER_ADDON_DATA_H_
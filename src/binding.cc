@@ -1,27 +1,42 @@
 #include <node.h>
 #include <v8.h>
+#include <nan.h>
+#include "./addon_data.h"
 #include "./language.h"
 #include "./node.h"
 #include "./parser.h"
 #include "./query.h"
+#include "./query_cursor.h"
+#include "./selector.h"
 #include "./tree.h"
 #include "./tree_cursor.h"
 #include "./conversions.h"
+#include "./flat_tree.h"
 
 namespace node_tree_sitter {
 
 using namespace v8;
 
-void InitAll(Local<Object> exports, Local<Value> m_, void* v_) {
-  InitConversions(exports);
-  node_methods::Init(exports);
+static void DeleteAddonData(void *data) {
+  delete static_cast<AddonData *>(data);
+}
+
+void InitAll(Local<Object> exports) {
+  AddonData *data = new AddonData();
+  node::AddEnvironmentCleanupHook(Isolate::GetCurrent(), DeleteAddonData, data);
+
+  InitConversions(exports, data);
+  node_methods::Init(exports, data);
   language_methods::Init(exports);
-  Parser::Init(exports);
-  Query::Init(exports);
-  Tree::Init(exports);
-  TreeCursor::Init(exports);
+  Parser::Init(exports, data);
+  Query::Init(exports, data);
+  QueryCursor::Init(exports, data);
+  Selector::Init(exports, data);
+  Tree::Init(exports, data);
+  TreeCursor::Init(exports, data);
+  flat_tree::Init(exports, data);
 }
 
-NODE_MODULE(tree_sitter_runtime_binding, InitAll)
+NAN_MODULE_WORKER_ENABLED(tree_sitter_runtime_binding, InitAll)
 
 }  // namespace node_tree_sitter
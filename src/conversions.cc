@@ -9,54 +9,44 @@ namespace node_tree_sitter {
 
 using namespace v8;
 
-Nan::Persistent<String> row_key;
-Nan::Persistent<String> column_key;
-Nan::Persistent<String> start_index_key;
-Nan::Persistent<String> start_position_key;
-Nan::Persistent<String> end_index_key;
-Nan::Persistent<String> end_position_key;
-
-static unsigned BYTES_PER_CHARACTER = 2;
-static uint32_t *point_transfer_buffer;
-
-void InitConversions(Local<Object> exports) {
-  row_key.Reset(Nan::Persistent<String>(Nan::New("row").ToLocalChecked()));
-  column_key.Reset(Nan::Persistent<String>(Nan::New("column").ToLocalChecked()));
-  start_index_key.Reset(Nan::Persistent<String>(Nan::New("startIndex").ToLocalChecked()));
-  start_position_key.Reset(Nan::Persistent<String>(Nan::New("startPosition").ToLocalChecked()));
-  end_index_key.Reset(Nan::Persistent<String>(Nan::New("endIndex").ToLocalChecked()));
-  end_position_key.Reset(Nan::Persistent<String>(Nan::New("endPosition").ToLocalChecked()));
+void InitConversions(Local<Object> exports, AddonData *data) {
+  data->row_key.Reset(Nan::Persistent<String>(Nan::New("row").ToLocalChecked()));
+  data->column_key.Reset(Nan::Persistent<String>(Nan::New("column").ToLocalChecked()));
+  data->start_index_key.Reset(Nan::Persistent<String>(Nan::New("startIndex").ToLocalChecked()));
+  data->start_position_key.Reset(Nan::Persistent<String>(Nan::New("startPosition").ToLocalChecked()));
+  data->end_index_key.Reset(Nan::Persistent<String>(Nan::New("endIndex").ToLocalChecked()));
+  data->end_position_key.Reset(Nan::Persistent<String>(Nan::New("endPosition").ToLocalChecked()));
 
   #if defined(_MSC_VER) && NODE_RUNTIME_ELECTRON && NODE_MODULE_VERSION >= 89
     auto js_point_transfer_buffer = ArrayBuffer::New(Isolate::GetCurrent(), 2 * sizeof(uint32_t));
-    point_transfer_buffer = (uint32_t *)(js_point_transfer_buffer->Data());
+    data->point_transfer_buffer = (uint32_t *)(js_point_transfer_buffer->Data());
   #elif V8_MAJOR_VERSION < 8 || (V8_MAJOR_VERSION == 8 && V8_MINOR_VERSION < 4) || (defined(_MSC_VER) && NODE_RUNTIME_ELECTRON)
-    point_transfer_buffer = static_cast<uint32_t *>(malloc(2 * sizeof(uint32_t)));
-    auto js_point_transfer_buffer = ArrayBuffer::New(Isolate::GetCurrent(), point_transfer_buffer, 2 * sizeof(uint32_t));
+    data->point_transfer_buffer = static_cast<uint32_t *>(malloc(2 * sizeof(uint32_t)));
+    auto js_point_transfer_buffer = ArrayBuffer::New(Isolate::GetCurrent(), data->point_transfer_buffer, 2 * sizeof(uint32_t));
   #else
-    point_transfer_buffer = static_cast<uint32_t *>(malloc(2 * sizeof(uint32_t)));
-    auto backing_store = ArrayBuffer::NewBackingStore(point_transfer_buffer, 2 * sizeof(uint32_t), BackingStore::EmptyDeleter, nullptr);
+    data->point_transfer_buffer = static_cast<uint32_t *>(malloc(2 * sizeof(uint32_t)));
+    auto backing_store = ArrayBuffer::NewBackingStore(data->point_transfer_buffer, 2 * sizeof(uint32_t), BackingStore::EmptyDeleter, nullptr);
     auto js_point_transfer_buffer = ArrayBuffer::New(Isolate::GetCurrent(), std::move(backing_store));
   #endif
 
   Nan::Set(exports, Nan::New("pointTransferArray").ToLocalChecked(), Uint32Array::New(js_point_transfer_buffer, 0, 2));
 }
 
-void TransferPoint(const TSPoint &point) {
-  point_transfer_buffer[0] = point.row;
-  point_transfer_buffer[1] = point.column / 2;
+void TransferPoint(AddonData *data, const TSPoint &point, TSInputEncoding encoding) {
+  data->point_transfer_buffer[0] = point.row;
+  data->point_transfer_buffer[1] = point.column / BytesPerCharacter(encoding);
 }
 
-Local<Object> RangeToJS(const TSRange &range) {
+Local<Object> RangeToJS(AddonData *data, const TSRange &range, TSInputEncoding encoding) {
   Local<Object> result = Nan::New<Object>();
-  Nan::Set(result, Nan::New(start_position_key), PointToJS(range.start_point));
-  Nan::Set(result, Nan::New(start_index_key), ByteCountToJS(range.start_byte));
-  Nan::Set(result, Nan::New(end_position_key), PointToJS(range.end_point));
-  Nan::Set(result, Nan::New(end_index_key), ByteCountToJS(range.end_byte));
+  Nan::Set(result, Nan::New(data->start_position_key), PointToJS(data, range.start_point, encoding));
+  Nan::Set(result, Nan::New(data->start_index_key), ByteCountToJS(range.start_byte, encoding));
+  Nan::Set(result, Nan::New(data->end_position_key), PointToJS(data, range.end_point, encoding));
+  Nan::Set(result, Nan::New(data->end_index_key), ByteCountToJS(range.end_byte, encoding));
   return result;
 }
 
-Nan::Maybe<TSRange> RangeFromJS(const Local<Value> &arg) {
+Nan::Maybe<TSRange> RangeFromJS(AddonData *data, const Local<Value> &arg, TSInputEncoding encoding) {
   if (!arg->IsObject()) {
     Nan::ThrowTypeError("Range must be a {startPosition, endPosition, startIndex, endIndex} object");
     return Nan::Nothing<TSRange>();
@@ -67,7 +57,7 @@ Nan::Maybe<TSRange> RangeFromJS(const Local<Value> &arg) {
   Local<Object> js_range = Local<Object>::Cast(arg);
 
   #define INIT(field, key, Convert) { \
-    auto value = Nan::Get(js_range, Nan::New(key)); \
+    auto value = Nan::Get(js_range, Nan::New(data->key)); \
     if (value.IsEmpty()) { \
       Nan::ThrowTypeError("Range must be a {startPosition, endPosition, startIndex, endIndex} object"); \
       return Nan::Nothing<TSRange>(); \
@@ -80,24 +70,27 @@ Nan::Maybe<TSRange> RangeFromJS(const Local<Value> &arg) {
     } \
   }
 
-  INIT(start_point, start_position_key, PointFromJS);
-  INIT(end_point, end_position_key, PointFromJS);
-  INIT(start_byte, start_index_key, ByteCountFromJS);
-  INIT(end_byte, end_index_key, ByteCountFromJS);
+  auto point_from_js = [&](const Local<Value> &value) { return PointFromJS(data, value, encoding); };
+  auto byte_count_from_js = [&](const Local<Value> &value) { return ByteCountFromJS(value, encoding); };
+
+  INIT(start_point, start_position_key, point_from_js);
+  INIT(end_point, end_position_key, point_from_js);
+  INIT(start_byte, start_index_key, byte_count_from_js);
+  INIT(end_byte, end_index_key, byte_count_from_js);
 
   #undef INIT
 
   return Nan::Just(result);
 }
 
-Local<Object> PointToJS(const TSPoint &point) {
+Local<Object> PointToJS(AddonData *data, const TSPoint &point, TSInputEncoding encoding) {
   Local<Object> result = Nan::New<Object>();
-  Nan::Set(result, Nan::New(row_key), Nan::New<Number>(point.row));
-  Nan::Set(result, Nan::New(column_key), ByteCountToJS(point.column));
+  Nan::Set(result, Nan::New(data->row_key), Nan::New<Number>(point.row));
+  Nan::Set(result, Nan::New(data->column_key), ByteCountToJS(point.column, encoding));
   return result;
 }
 
-Nan::Maybe<TSPoint> PointFromJS(const Local<Value> &arg) {
+Nan::Maybe<TSPoint> PointFromJS(AddonData *data, const Local<Value> &arg, TSInputEncoding encoding) {
   Local<Object> js_point;
   if (!arg->IsObject() || !Nan::To<Object>(arg).ToLocal(&js_point)) {
     Nan::ThrowTypeError("Point must be a {row, column} object");
@@ -105,13 +98,13 @@ Nan::Maybe<TSPoint> PointFromJS(const Local<Value> &arg) {
   }
 
   Local<Value> js_row;
-  if (!Nan::Get(js_point, Nan::New(row_key)).ToLocal(&js_row)) {
+  if (!Nan::Get(js_point, Nan::New(data->row_key)).ToLocal(&js_row)) {
     Nan::ThrowTypeError("Point must be a {row, column} object");
     return Nan::Nothing<TSPoint>();
   }
 
   Local<Value> js_column;
-  if (!Nan::Get(js_point, Nan::New(column_key)).ToLocal(&js_column)) {
+  if (!Nan::Get(js_point, Nan::New(data->column_key)).ToLocal(&js_column)) {
     Nan::ThrowTypeError("Point must be a {row, column} object");
     return Nan::Nothing<TSPoint>();
   }
@@ -130,7 +123,7 @@ Nan::Maybe<TSPoint> PointFromJS(const Local<Value> &arg) {
   if (!std::isfinite(Nan::To<double>(js_column).FromMaybe(0))) {
     column = UINT32_MAX;
   } else if (js_column->IsNumber()) {
-    column = Nan::To<uint32_t>(js_column).FromMaybe(0) * BYTES_PER_CHARACTER;
+    column = Nan::To<uint32_t>(js_column).FromMaybe(0) * BytesPerCharacter(encoding);
   } else {
     Nan::ThrowTypeError("Point.column must be a number");
     return Nan::Nothing<TSPoint>();
@@ -139,18 +132,18 @@ Nan::Maybe<TSPoint> PointFromJS(const Local<Value> &arg) {
   return Nan::Just<TSPoint>({row, column});
 }
 
-Local<Number> ByteCountToJS(uint32_t byte_count) {
-  return Nan::New<Number>(byte_count / BYTES_PER_CHARACTER);
+Local<Number> ByteCountToJS(uint32_t byte_count, TSInputEncoding encoding) {
+  return Nan::New<Number>(byte_count / BytesPerCharacter(encoding));
 }
 
-Nan::Maybe<uint32_t> ByteCountFromJS(const v8::Local<v8::Value> &arg) {
+Nan::Maybe<uint32_t> ByteCountFromJS(const v8::Local<v8::Value> &arg, TSInputEncoding encoding) {
   auto result = Nan::To<uint32_t>(arg);
   if (!arg->IsNumber()) {
     Nan::ThrowTypeError("Character index must be a number");
     return Nan::Nothing<uint32_t>();
   }
 
-  return Nan::Just<uint32_t>(result.FromJust() * BYTES_PER_CHARACTER);
+  return Nan::Just<uint32_t>(result.FromJust() * BytesPerCharacter(encoding));
 }
 
 }  // namespace node_tree_sitter
@@ -4,22 +4,24 @@
 #include <nan.h>
 #include <v8.h>
 #include <tree_sitter/api.h>
+#include "./addon_data.h"
 
 namespace node_tree_sitter {
 
-void InitConversions(v8::Local<v8::Object> exports);
-v8::Local<v8::Object> RangeToJS(const TSRange &);
-v8::Local<v8::Object> PointToJS(const TSPoint &);
-void TransferPoint(const TSPoint &);
-v8::Local<v8::Number> ByteCountToJS(uint32_t);
-Nan::Maybe<TSPoint> PointFromJS(const v8::Local<v8::Value> &);
-Nan::Maybe<uint32_t> ByteCountFromJS(const v8::Local<v8::Value> &);
-Nan::Maybe<TSRange> RangeFromJS(const v8::Local<v8::Value> &);
+// Indices and columns are exposed to JavaScript in characters: UTF-16 code
+// units for trees parsed from strings, and bytes for UTF-8 trees.
+static inline uint32_t BytesPerCharacter(TSInputEncoding encoding) {
+  return encoding == TSInputEncodingUTF8 ? 1 : 2;
+}
 
-extern Nan::Persistent<v8::String> row_key;
-extern Nan::Persistent<v8::String> column_key;
-extern Nan::Persistent<v8::String> start_key;
-extern Nan::Persistent<v8::String> end_key;
+void InitConversions(v8::Local<v8::Object> exports, AddonData *);
+v8::Local<v8::Object> RangeToJS(AddonData *, const TSRange &, TSInputEncoding);
+v8::Local<v8::Object> PointToJS(AddonData *, const TSPoint &, TSInputEncoding);
+void TransferPoint(AddonData *, const TSPoint &, TSInputEncoding);
+v8::Local<v8::Number> ByteCountToJS(uint32_t, TSInputEncoding);
+Nan::Maybe<TSPoint> PointFromJS(AddonData *, const v8::Local<v8::Value> &, TSInputEncoding);
+Nan::Maybe<uint32_t> ByteCountFromJS(const v8::Local<v8::Value> &, TSInputEncoding);
+Nan::Maybe<TSRange> RangeFromJS(AddonData *, const v8::Local<v8::Value> &, TSInputEncoding);
 
 }  // namespace node_tree_sitter
 
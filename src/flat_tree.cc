@@ -0,0 +1,303 @@
+#include "./flat_tree.h"
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <v8.h>
+#include <nan.h>
+#include <tree_sitter/api.h>
+#include "./addon_data.h"
+#include "./conversions.h"
+#include "./language.h"
+#include "./tree.h"
+#include "./util.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace node_tree_sitter {
+namespace flat_tree {
+
+using std::vector;
+using namespace v8;
+
+const char *column_names[kColumnCount] = {
+  "typeId",
+  "fieldId",
+  "startIndex",
+  "endIndex",
+  "startRow",
+  "startColumn",
+  "endRow",
+  "endColumn",
+  "parent",
+  "firstChild",
+  "nextSibling",
+  "flags",
+};
+
+// A snapshot is this header, followed by the columns of the flattened tree.
+// It is written in the byte order of the machine that wrote it, and the
+// reader rejects snapshots whose magic number doesn't match its own order.
+struct SnapshotHeader {
+  uint32_t magic;
+  uint32_t format_version;
+  uint32_t encoding;
+  uint32_t node_count;
+  uint32_t column_count;
+  uint32_t language_version;
+  uint32_t language_fingerprint;
+  uint32_t reserved;
+};
+
+static const uint32_t SNAPSHOT_MAGIC = 0x54535446;  // "FTST" in little-endian order
+static const uint32_t SNAPSHOT_FORMAT_VERSION = 1;
+
+// Moves the cursor to the next node in a pre-order traversal, keeping track
+// of the cursor's depth.
+static bool goto_next_node(TSTreeCursor *cursor, uint32_t *depth) {
+  if (ts_tree_cursor_goto_first_child(cursor)) {
+    (*depth)++;
+    return true;
+  }
+  while (!ts_tree_cursor_goto_next_sibling(cursor)) {
+    if (!ts_tree_cursor_goto_parent(cursor)) return false;
+    (*depth)--;
+  }
+  return true;
+}
+
+uint32_t CountNodes(TSNode root) {
+  uint32_t node_count = 0;
+  uint32_t depth = 0;
+  TSTreeCursor cursor = ts_tree_cursor_new(root);
+  do {
+    node_count++;
+  } while (goto_next_node(&cursor, &depth));
+  ts_tree_cursor_delete(&cursor);
+  return node_count;
+}
+
+void FlattenTree(TSNode root, TSInputEncoding encoding, uint32_t node_count, uint32_t *data) {
+  uint32_t bytes_per_character = BytesPerCharacter(encoding);
+  uint32_t *columns[kColumnCount];
+  for (unsigned i = 0; i < kColumnCount; i++) {
+    columns[i] = data + i * node_count;
+  }
+
+  // The most recently visited node at each depth: the parent of the next
+  // node one level deeper, and the previous sibling of the next node at the
+  // same level.
+  vector<uint32_t> last_node_at_depth;
+
+  TSTreeCursor cursor = ts_tree_cursor_new(root);
+  uint32_t depth = 0;
+  uint32_t index = 0;
+  do {
+    if (depth + 1 >= last_node_at_depth.size()) {
+      last_node_at_depth.resize(depth + 2, NODE_NONE);
+    }
+
+    TSNode node = ts_tree_cursor_current_node(&cursor);
+    TSPoint start_point = ts_node_start_point(node);
+    TSPoint end_point = ts_node_end_point(node);
+    uint32_t parent = depth > 0 ? last_node_at_depth[depth - 1] : NODE_NONE;
+    uint32_t previous_sibling = last_node_at_depth[depth];
+
+    uint32_t flags = 0;
+    if (ts_node_is_named(node)) flags |= NODE_NAMED;
+    if (ts_node_symbol(node) == (TSSymbol)-1) flags |= NODE_ERROR;
+    if (ts_node_is_missing(node)) flags |= NODE_MISSING;
+    if (ts_node_is_extra(node)) flags |= NODE_EXTRA;
+    if (ts_node_has_error(node)) flags |= NODE_HAS_ERROR;
+
+    columns[kTypeId][index] = ts_node_symbol(node);
+    columns[kFieldId][index] = ts_tree_cursor_current_field_id(&cursor);
+    columns[kStartIndex][index] = ts_node_start_byte(node) / bytes_per_character;
+    columns[kEndIndex][index] = ts_node_end_byte(node) / bytes_per_character;
+    columns[kStartRow][index] = start_point.row;
+    columns[kStartColumn][index] = start_point.column / bytes_per_character;
+    columns[kEndRow][index] = end_point.row;
+    columns[kEndColumn][index] = end_point.column / bytes_per_character;
+    columns[kParent][index] = parent;
+    columns[kFirstChild][index] = NODE_NONE;
+    columns[kNextSibling][index] = NODE_NONE;
+    columns[kFlags][index] = flags;
+
+    if (previous_sibling != NODE_NONE) {
+      columns[kNextSibling][previous_sibling] = index;
+    } else if (parent != NODE_NONE) {
+      columns[kFirstChild][parent] = index;
+    }
+
+    // The next node one level deeper, if any, is this node's first child.
+    last_node_at_depth[depth] = index++;
+    last_node_at_depth[depth + 1] = NODE_NONE;
+  } while (index < node_count && goto_next_node(&cursor, &depth));
+
+  ts_tree_cursor_delete(&cursor);
+}
+
+// Identifies a grammar by its symbol and field names, so that a snapshot is
+// never read with a language whose ids mean something else.
+static uint32_t language_fingerprint(const TSLanguage *language) {
+  uint32_t hash = 2166136261u;
+  auto add_bytes = [&hash](const void *bytes, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+      hash ^= ((const uint8_t *)bytes)[i];
+      hash *= 16777619u;
+    }
+  };
+  auto add_name = [&add_bytes](const char *name) {
+    if (name) add_bytes(name, strlen(name));
+    add_bytes("", 1);
+  };
+
+  uint32_t symbol_count = ts_language_symbol_count(language);
+  add_bytes(&symbol_count, sizeof(symbol_count));
+  for (uint32_t i = 0; i < symbol_count; i++) {
+    uint8_t type = ts_language_symbol_type(language, i);
+    add_name(ts_language_symbol_name(language, i));
+    add_bytes(&type, 1);
+  }
+
+  uint32_t field_count = ts_language_field_count(language);
+  add_bytes(&field_count, sizeof(field_count));
+  for (uint32_t i = 1; i <= field_count; i++) {
+    add_name(ts_language_field_name_for_id(language, i));
+  }
+
+  return hash;
+}
+
+static void SerializeTree(const Nan::FunctionCallbackInfo<Value> &info) {
+  const Tree *tree = Tree::UnwrapTree(GetAddonData(info), info[0]);
+  if (!tree) {
+    Nan::ThrowTypeError("Argument must be a tree");
+    return;
+  }
+
+  TSNode root = ts_tree_root_node(tree->tree_);
+  const TSLanguage *language = ts_tree_language(tree->tree_);
+  uint32_t node_count = CountNodes(root);
+  size_t size = sizeof(SnapshotHeader) + (size_t)node_count * kColumnCount * sizeof(uint32_t);
+
+  Local<Object> buffer;
+  if (!Nan::NewBuffer(size).ToLocal(&buffer)) return;
+  char *data = node::Buffer::Data(buffer);
+
+  SnapshotHeader header = {
+    SNAPSHOT_MAGIC,
+    SNAPSHOT_FORMAT_VERSION,
+    (uint32_t)tree->encoding_,
+    node_count,
+    kColumnCount,
+    ts_language_version(language),
+    language_fingerprint(language),
+    0,
+  };
+  memcpy(data, &header, sizeof(header));
+  FlattenTree(root, tree->encoding_, node_count, (uint32_t *)(data + sizeof(header)));
+
+  info.GetReturnValue().Set(buffer);
+}
+
+static void GetLanguageFingerprint(const Nan::FunctionCallbackInfo<Value> &info) {
+  const TSLanguage *language = language_methods::UnwrapLanguage(info[0]);
+  if (!language) return;
+  info.GetReturnValue().Set(Nan::New(language_fingerprint(language)));
+}
+
+#ifndef _WIN32
+static void unmap_buffer(char *data, void *hint) {
+  munmap(data, (size_t)hint);
+}
+#endif
+
+// Maps a snapshot file into memory, so that loading it costs nothing until
+// its pages are touched and the pages are shared between processes. The
+// mapping is private and copy-on-write, since the buffer is writable from
+// JavaScript: pages that are written to are copied, and the file is never
+// changed. Where external memory isn't available to buffers (Windows, and
+// Electron's V8 memory cage), the file is read into a buffer instead.
+static void MapFile(const Nan::FunctionCallbackInfo<Value> &info) {
+  Nan::Utf8String path(info[0]);
+  if (!*path) {
+    Nan::ThrowTypeError("Path must be a string");
+    return;
+  }
+
+  #if !defined(_WIN32) && !NODE_RUNTIME_ELECTRON
+    int fd = open(*path, O_RDONLY);
+    if (fd < 0) {
+      Nan::ThrowError(Nan::ErrnoException(errno, "open", nullptr, *path));
+      return;
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) < 0) {
+      int error = errno;
+      close(fd);
+      Nan::ThrowError(Nan::ErrnoException(error, "fstat", nullptr, *path));
+      return;
+    }
+
+    size_t size = file_stat.st_size;
+    if (size == 0) {
+      close(fd);
+      info.GetReturnValue().Set(Nan::NewBuffer(0).ToLocalChecked());
+      return;
+    }
+
+    void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+      Nan::ThrowError(Nan::ErrnoException(errno, "mmap", nullptr, *path));
+      return;
+    }
+
+    Local<Object> buffer;
+    if (Nan::NewBuffer((char *)data, size, unmap_buffer, (void *)size).ToLocal(&buffer)) {
+      info.GetReturnValue().Set(buffer);
+    }
+  #else
+    std::ifstream file(*path, std::ios::binary | std::ios::ate);
+    if (!file) {
+      Nan::ThrowError((std::string("Could not open ") + *path).c_str());
+      return;
+    }
+    std::string contents(file.tellg(), '\0');
+    file.seekg(0);
+    file.read(&contents[0], contents.size());
+
+    Local<Object> buffer;
+    if (Nan::CopyBuffer(contents.data(), contents.size()).ToLocal(&buffer)) {
+      info.GetReturnValue().Set(buffer);
+    }
+  #endif
+}
+
+void Init(Local<Object> exports, AddonData *data) {
+  Local<External> data_ext = Nan::New<External>(data);
+
+  FunctionPair methods[] = {
+    {"serializeTree", SerializeTree},
+    {"getLanguageFingerprint", GetLanguageFingerprint},
+    {"mapFile", MapFile},
+  };
+
+  for (size_t i = 0; i < length_of_array(methods); i++) {
+    Nan::Set(
+      exports,
+      Nan::New(methods[i].name).ToLocalChecked(),
+      Nan::GetFunction(Nan::New<FunctionTemplate>(methods[i].callback, data_ext)).ToLocalChecked()
+    );
+  }
+}
+
+}  // namespace flat_tree
+}  // namespace node_tree_sitter
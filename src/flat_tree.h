@@ -0,0 +1,50 @@
+#ifndef NODE_TREE_SITTER_FLAT_TREE_H_
+#define NODE_TREE_SITTER_FLAT_TREE_H_
+
+#include <v8.h>
+#include <nan.h>
+#include <tree_sitter/api.h>
+#include "./addon_data.h"
+
+namespace node_tree_sitter {
+namespace flat_tree {
+
+// A flattened tree stores its nodes in pre-order, as one column of
+// `uint32_t`s per field.
+enum Column {
+  kTypeId,
+  kFieldId,
+  kStartIndex,
+  kEndIndex,
+  kStartRow,
+  kStartColumn,
+  kEndRow,
+  kEndColumn,
+  kParent,
+  kFirstChild,
+  kNextSibling,
+  kFlags,
+  kColumnCount,
+};
+
+extern const char *column_names[kColumnCount];
+
+static const uint32_t NODE_NONE = UINT32_MAX;
+static const uint32_t NODE_NAMED = 1 << 0;
+static const uint32_t NODE_ERROR = 1 << 1;
+static const uint32_t NODE_MISSING = 1 << 2;
+static const uint32_t NODE_EXTRA = 1 << 3;
+static const uint32_t NODE_HAS_ERROR = 1 << 4;
+
+void Init(v8::Local<v8::Object>, AddonData *);
+
+uint32_t CountNodes(TSNode root);
+
+// Fills `node_count * kColumnCount` words of `columns`, one column after the
+// other. Indices and columns are in the units of the given encoding.
+void FlattenTree(TSNode root, TSInputEncoding, uint32_t node_count, uint32_t *columns);
+
+}  // namespace flat_tree
+}  // namespace node_tree_sitter
+
+#endif  // NODE_TREE_SITTER_FLAT_TREE_H_
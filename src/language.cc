@@ -38,16 +38,63 @@ const TSLanguage *UnwrapLanguage(const v8::Local<v8::Value> &value) {
   return nullptr;
 }
 
+// Names are internalized, so that comparing them in JavaScript is cheap.
+static Local<String> internalized_string(const char *value) {
+  return String::NewFromUtf8(
+    Isolate::GetCurrent(), value ? value : "", NewStringType::kInternalized
+  ).ToLocalChecked();
+}
+
+static AddonData::LanguageNames &language_names(AddonData *data, const TSLanguage *language) {
+  AddonData::LanguageNames &names = data->language_names[language];
+  if (names.type_names.empty()) {
+    // Two more entries for the builtin error symbols, which are numbered
+    // down from the end of the symbol range.
+    names.type_names.resize(ts_language_symbol_count(language) + 2);
+    names.field_names.resize(ts_language_field_count(language) + 1);
+  }
+  return names;
+}
+
+Local<String> TypeName(AddonData *data, const TSLanguage *language, TSSymbol symbol) {
+  AddonData::LanguageNames &names = language_names(data, language);
+  size_t symbol_count = names.type_names.size() - 2;
+  size_t index = symbol < symbol_count
+    ? symbol
+    : symbol_count + static_cast<TSSymbol>(-1) - symbol;
+  if (index >= names.type_names.size()) {
+    return internalized_string(ts_language_symbol_name(language, symbol));
+  }
+
+  Nan::Global<String> &name = names.type_names[index];
+  if (name.IsEmpty()) name.Reset(internalized_string(ts_language_symbol_name(language, symbol)));
+  return Nan::New(name);
+}
+
+Local<String> FieldName(AddonData *data, const TSLanguage *language, TSFieldId field_id) {
+  AddonData::LanguageNames &names = language_names(data, language);
+  if (field_id >= names.field_names.size()) {
+    return internalized_string(ts_language_field_name_for_id(language, field_id));
+  }
+
+  Nan::Global<String> &name = names.field_names[field_id];
+  if (name.IsEmpty()) name.Reset(internalized_string(ts_language_field_name_for_id(language, field_id)));
+  return Nan::New(name);
+}
+
+// Returns the names of the named node types, or of all node types when the
+// second argument is true.
 static void GetNodeTypeNamesById(const Nan::FunctionCallbackInfo<Value> &info) {
   const TSLanguage *language = UnwrapLanguage(info[0]);
   if (!language) return;
+  bool include_anonymous = Nan::To<bool>(info[1]).FromMaybe(false);
 
   auto result = Nan::New<Array>();
   uint32_t length = ts_language_symbol_count(language);
   for (uint32_t i = 0; i < length; i++) {
     const char *name = ts_language_symbol_name(language, i);
     TSSymbolType type = ts_language_symbol_type(language, i);
-    if (type == TSSymbolTypeRegular) {
+    if (type == TSSymbolTypeRegular || (include_anonymous && type == TSSymbolTypeAnonymous)) {
       Nan::Set(result, i, Nan::New(name).ToLocalChecked());
     } else {
       Nan::Set(result, i, Nan::Null());
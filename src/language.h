@@ -5,6 +5,7 @@
 #include <v8.h>
 #include <node_object_wrap.h>
 #include <tree_sitter/api.h>
+#include "./addon_data.h"
 #include "./tree.h"
 
 namespace node_tree_sitter {
@@ -14,6 +15,11 @@ void Init(v8::Local<v8::Object>);
 
 const TSLanguage *UnwrapLanguage(const v8::Local<v8::Value> &);
 
+// Returns the name of a node type or field as an internalized string, which is
+// shared by every lookup of the same name.
+v8::Local<v8::String> TypeName(AddonData *, const TSLanguage *, TSSymbol);
+v8::Local<v8::String> FieldName(AddonData *, const TSLanguage *, TSFieldId);
+
 }  // namespace language_methods
 }  // namespace node_tree_sitter
 
@@ -1,5 +1,7 @@
 #include "./logger.h"
+#include <algorithm>
 #include <string>
+#include <cstring>
 #include <v8.h>
 #include <nan.h>
 #include <tree_sitter/api.h>
@@ -64,4 +66,90 @@ TSLogger Logger::Make(Local<Function> func) {
   return result;
 }
 
+static const size_t LOG_RECORD_HEADER_SIZE = 3;
+static const size_t MAX_LOG_MESSAGE_LENGTH = 0xFFFF;
+
+LogBuffer::LogBuffer(size_t capacity, bool log_parse, bool log_lex, uint32_t sample_interval)
+  : buffer_(capacity),
+    start_(0),
+    size_(0),
+    log_parse_(log_parse),
+    log_lex_(log_lex),
+    sample_interval_(sample_interval ? sample_interval : 1),
+    parse_count_(0),
+    is_sampling_(true) {}
+
+TSLogger LogBuffer::Make(LogBuffer *log_buffer) {
+  TSLogger result;
+  result.payload = (void *)log_buffer;
+  result.log = Log;
+  return result;
+}
+
+void LogBuffer::Log(void *payload, TSLogType type, const char *message) {
+  LogBuffer *log_buffer = (LogBuffer *)payload;
+  if (!log_buffer->is_sampling_) return;
+  if (type == TSLogTypeParse ? !log_buffer->log_parse_ : !log_buffer->log_lex_) return;
+  log_buffer->Push(type, message, strlen(message));
+}
+
+void LogBuffer::StartParse() {
+  is_sampling_ = parse_count_ % sample_interval_ == 0;
+  parse_count_++;
+}
+
+void LogBuffer::Push(TSLogType type, const char *message, size_t length) {
+  size_t capacity = buffer_.size();
+  if (capacity <= LOG_RECORD_HEADER_SIZE) return;
+  length = std::min(length, std::min(MAX_LOG_MESSAGE_LENGTH, capacity - LOG_RECORD_HEADER_SIZE));
+  size_t record_size = LOG_RECORD_HEADER_SIZE + length;
+
+  while (size_ + record_size > capacity) {
+    size_t oldest_length = ByteAt(start_ + 1) | (ByteAt(start_ + 2) << 8);
+    size_t oldest_size = LOG_RECORD_HEADER_SIZE + oldest_length;
+    start_ = (start_ + oldest_size) % capacity;
+    size_ -= oldest_size;
+  }
+
+  char header[LOG_RECORD_HEADER_SIZE] = {
+    static_cast<char>(type == TSLogTypeParse ? 0 : 1),
+    static_cast<char>(length & 0xFF),
+    static_cast<char>(length >> 8),
+  };
+  Write(start_ + size_, header, LOG_RECORD_HEADER_SIZE);
+  Write(start_ + size_ + LOG_RECORD_HEADER_SIZE, message, length);
+  size_ += record_size;
+}
+
+void LogBuffer::Write(size_t offset, const char *data, size_t length) {
+  size_t capacity = buffer_.size();
+  offset %= capacity;
+  size_t first_part = std::min(length, capacity - offset);
+  memcpy(&buffer_[offset], data, first_part);
+  memcpy(&buffer_[0], data + first_part, length - first_part);
+}
+
+uint8_t LogBuffer::ByteAt(size_t offset) const {
+  return static_cast<uint8_t>(buffer_[offset % buffer_.size()]);
+}
+
+std::vector<char> LogBuffer::Drain() {
+  std::vector<char> result(size_);
+  size_t first_part = std::min(size_, buffer_.size() - start_);
+  std::copy(buffer_.begin() + start_, buffer_.begin() + start_ + first_part, result.begin());
+  std::copy(buffer_.begin(), buffer_.begin() + (size_ - first_part), result.begin() + first_part);
+  start_ = 0;
+  size_ = 0;
+  return result;
+}
+
+void DeleteLogger(TSLogger logger) {
+  if (!logger.payload) return;
+  if (logger.log == Logger::Log) {
+    delete (Logger *)logger.payload;
+  } else if (logger.log == LogBuffer::Log) {
+    delete (LogBuffer *)logger.payload;
+  }
+}
+
 }  // namespace node_tree_sitter
@@ -4,6 +4,7 @@
 #include <v8.h>
 #include <nan.h>
 #include <tree_sitter/api.h>
+#include <vector>
 
 namespace node_tree_sitter {
 
@@ -14,6 +15,41 @@ class Logger {
   static void Log(void *, TSLogType, const char *);
 };
 
+// A logger that records messages in a fixed-size ring buffer, without
+// calling into JavaScript, so that it can stay enabled in production and be
+// drained in bulk. Each record is a type byte (0 for parse, 1 for lex), a
+// little-endian 16-bit length and the message. When the buffer is full, the
+// oldest records are dropped.
+class LogBuffer {
+ public:
+  LogBuffer(size_t capacity, bool log_parse, bool log_lex, uint32_t sample_interval);
+
+  static TSLogger Make(LogBuffer *);
+  static void Log(void *, TSLogType, const char *);
+
+  // Called before each parse, to decide whether the parse is sampled.
+  void StartParse();
+  std::vector<char> Drain();
+
+ private:
+  void Push(TSLogType, const char *, size_t);
+  void Write(size_t offset, const char *, size_t);
+  uint8_t ByteAt(size_t offset) const;
+
+  std::vector<char> buffer_;
+  size_t start_;
+  size_t size_;
+  bool log_parse_;
+  bool log_lex_;
+  uint32_t sample_interval_;
+  uint32_t parse_count_;
+  bool is_sampling_;
+};
+
+// Deletes the payload of a logger created by `Logger::Make` or
+// `LogBuffer::Make`.
+void DeleteLogger(TSLogger);
+
 
 }  // namespace node_tree_sitter
 
@@ -3,47 +3,60 @@
 #include <tree_sitter/api.h>
 #include <vector>
 #include <v8.h>
+#include "./addon_data.h"
 #include "./util.h"
 #include "./conversions.h"
+#include "./language.h"
+#include "./selector.h"
 #include "./tree.h"
 #include "./tree_cursor.h"
 
+// V8's Fast API lets optimized code call the simplest node getters directly,
+// without setting up a FunctionCallbackInfo.
+#if defined(__has_include)
+  #if __has_include(<v8-fast-api-calls.h>) && \
+      (V8_MAJOR_VERSION > 10 || (V8_MAJOR_VERSION == 10 && V8_MINOR_VERSION >= 2))
+    #include <v8-fast-api-calls.h>
+    #define NODE_TREE_SITTER_FAST_API 1
+  #endif
+#endif
+
 namespace node_tree_sitter {
 namespace node_methods {
 
 using std::vector;
 using namespace v8;
 
-static const uint32_t FIELD_COUNT_PER_NODE = 6;
-
-static uint32_t *transfer_buffer = nullptr;
-static uint32_t transfer_buffer_length = 0;
-static Nan::Persistent<Object> module_exports;
-static TSTreeCursor scratch_cursor = {nullptr, nullptr, {0, 0}};
+// A node is transferred as the two words of its id, its four context words
+// and the edit generation of its tree that the context is up to date with.
+static const uint32_t FIELD_COUNT_PER_NODE = 7;
+static const uint32_t CONTEXT_FIELD_INDEX = 2;
+static const uint32_t EDIT_GENERATION_FIELD_INDEX = 6;
 
-static inline void setup_transfer_buffer(uint32_t node_count) {
+static inline void setup_transfer_buffer(AddonData *data, uint32_t node_count) {
   uint32_t new_length = node_count * FIELD_COUNT_PER_NODE;
-  if (new_length > transfer_buffer_length) {
-    transfer_buffer_length = new_length;
+  if (new_length > data->transfer_buffer_length) {
+    data->transfer_buffer_length = new_length;
+    size_t byte_length = new_length * sizeof(uint32_t);
 
     #if defined(_MSC_VER) && NODE_RUNTIME_ELECTRON && NODE_MODULE_VERSION >= 89
-      auto js_transfer_buffer = ArrayBuffer::New(Isolate::GetCurrent(), transfer_buffer_length * sizeof(uint32_t));
-      transfer_buffer = (uint32_t *)(js_transfer_buffer->Data());
+      auto js_transfer_buffer = ArrayBuffer::New(Isolate::GetCurrent(), byte_length);
+      data->transfer_buffer = (uint32_t *)(js_transfer_buffer->Data());
     #elif V8_MAJOR_VERSION < 8 || (V8_MAJOR_VERSION == 8 && V8_MINOR_VERSION < 4) || (defined(_MSC_VER) && NODE_RUNTIME_ELECTRON)
-      if (transfer_buffer) { free(transfer_buffer); }
-      transfer_buffer = static_cast<uint32_t *>(malloc(transfer_buffer_length * sizeof(uint32_t)));
-      auto js_transfer_buffer = ArrayBuffer::New(Isolate::GetCurrent(), transfer_buffer, transfer_buffer_length * sizeof(uint32_t));
+      if (data->transfer_buffer) { free(data->transfer_buffer); }
+      data->transfer_buffer = static_cast<uint32_t *>(malloc(byte_length));
+      auto js_transfer_buffer = ArrayBuffer::New(Isolate::GetCurrent(), data->transfer_buffer, byte_length);
     #else
-      if (transfer_buffer) { free(transfer_buffer); }
-      transfer_buffer = static_cast<uint32_t *>(malloc(transfer_buffer_length * sizeof(uint32_t)));
-      auto backing_store = ArrayBuffer::NewBackingStore(transfer_buffer, transfer_buffer_length * sizeof(uint32_t), BackingStore::EmptyDeleter, nullptr);
+      if (data->transfer_buffer) { free(data->transfer_buffer); }
+      data->transfer_buffer = static_cast<uint32_t *>(malloc(byte_length));
+      auto backing_store = ArrayBuffer::NewBackingStore(data->transfer_buffer, byte_length, BackingStore::EmptyDeleter, nullptr);
       auto js_transfer_buffer = ArrayBuffer::New(Isolate::GetCurrent(), std::move(backing_store));
     #endif
 
     Nan::Set(
-      Nan::New(module_exports),
+      Nan::New(data->module_exports),
       Nan::New("nodeTransferArray").ToLocalChecked(),
-      Uint32Array::New(js_transfer_buffer, 0, transfer_buffer_length)
+      Uint32Array::New(js_transfer_buffer, 0, new_length)
     );
   }
 }
@@ -65,9 +78,10 @@ void MarshalNode(const Nan::FunctionCallbackInfo<Value> &info, const Tree *tree,
 
 Local<Value> GetMarshalNodes(const Nan::FunctionCallbackInfo<Value> &info,
                          const Tree *tree, const TSNode *nodes, uint32_t node_count) {
+  AddonData *data = GetAddonData(info);
   auto result = Nan::New<Array>();
-  setup_transfer_buffer(node_count);
-  uint32_t *p = transfer_buffer;
+  setup_transfer_buffer(data, node_count);
+  uint32_t *p = data->transfer_buffer;
   for (unsigned i = 0; i < node_count; i++) {
     TSNode node = nodes[i];
     const auto &cache_entry = tree->cached_nodes_.find(node.id);
@@ -78,6 +92,7 @@ Local<Value> GetMarshalNodes(const Nan::FunctionCallbackInfo<Value> &info,
       *(p++) = node.context[1];
       *(p++) = node.context[2];
       *(p++) = node.context[3];
+      *(p++) = tree->EditGeneration();
       if (node.id) {
         Nan::Set(result, i, Nan::New(ts_node_symbol(node)));
       } else {
@@ -93,14 +108,16 @@ Local<Value> GetMarshalNodes(const Nan::FunctionCallbackInfo<Value> &info,
 Local<Value> GetMarshalNode(const Nan::FunctionCallbackInfo<Value> &info, const Tree *tree, TSNode node) {
   const auto &cache_entry = tree->cached_nodes_.find(node.id);
   if (cache_entry == tree->cached_nodes_.end()) {
-    setup_transfer_buffer(1);
-    uint32_t *p = transfer_buffer;
+    AddonData *data = GetAddonData(info);
+    setup_transfer_buffer(data, 1);
+    uint32_t *p = data->transfer_buffer;
     MarshalNodeId(node.id, p);
     p += 2;
     *(p++) = node.context[0];
     *(p++) = node.context[1];
     *(p++) = node.context[2];
     *(p++) = node.context[3];
+    *(p++) = tree->EditGeneration();
     if (node.id) {
       return Nan::New(ts_node_symbol(node));
     }
@@ -110,97 +127,106 @@ Local<Value> GetMarshalNode(const Nan::FunctionCallbackInfo<Value> &info, const
   return Nan::Null();
 }
 
-void MarshalNullNode() {
-  memset(transfer_buffer, 0, FIELD_COUNT_PER_NODE * sizeof(transfer_buffer[0]));
+void MarshalNullNode(AddonData *data) {
+  memset(data->transfer_buffer, 0, FIELD_COUNT_PER_NODE * sizeof(data->transfer_buffer[0]));
 }
 
-TSNode UnmarshalNode(const Tree *tree) {
-  TSNode result = {{0, 0, 0, 0}, nullptr, nullptr};
-  result.tree = tree->tree_;
-  if (!result.tree) {
-    Nan::ThrowTypeError("Argument must be a tree");
-    return result;
-  }
+// Reads a node from its fields, in the layout of the transfer buffer, and
+// brings it up to date with the edits made to its tree since then. Unless
+// `update_wrapper` is false, the node's cached wrapper is updated too.
+static inline TSNode node_from_fields(const Tree *tree, const uint32_t *fields,
+                                      bool update_wrapper = true) {
+  TSNode result = {{0, 0, 0, 0}, nullptr, tree->tree_};
+  result.id = UnmarshalNodeId(&fields[0]);
+  result.context[0] = fields[2];
+  result.context[1] = fields[3];
+  result.context[2] = fields[4];
+  result.context[3] = fields[5];
 
-  result.id = UnmarshalNodeId(&transfer_buffer[0]);
-  result.context[0] = transfer_buffer[2];
-  result.context[1] = transfer_buffer[3];
-  result.context[2] = transfer_buffer[4];
-  result.context[3] = transfer_buffer[5];
+  uint32_t edit_generation = fields[EDIT_GENERATION_FIELD_INDEX];
+  if (result.id && edit_generation != tree->EditGeneration()) {
+    result = update_wrapper
+      ? tree->CatchUpNode(result, edit_generation)
+      : tree->EditNode(result, edit_generation);
+  }
   return result;
 }
 
-static void ToString(const Nan::FunctionCallbackInfo<Value> &info) {
-  const Tree *tree = Tree::UnwrapTree(info[0]);
-  TSNode node = UnmarshalNode(tree);
-  if (node.id) {
-    const char *string = ts_node_string(node);
-    info.GetReturnValue().Set(Nan::New(string).ToLocalChecked());
-    free((char *)string);
+TSNode UnmarshalNode(AddonData *data, const Tree *tree) {
+  if (!tree || !tree->tree_) {
+    Nan::ThrowTypeError("Argument must be a tree");
+    return {{0, 0, 0, 0}, nullptr, nullptr};
   }
+  return node_from_fields(tree, data->transfer_buffer);
 }
 
-static void IsMissing(const Nan::FunctionCallbackInfo<Value> &info) {
-  const Tree *tree = Tree::UnwrapTree(info[0]);
-  TSNode node = UnmarshalNode(tree);
-  if (node.id) {
-    bool result = ts_node_is_missing(node);
-    info.GetReturnValue().Set(Nan::New<Boolean>(result));
+bool GetNodeContext(Local<Object> js_node, TSNode *node, uint32_t *edit_generation) {
+  for (unsigned i = 0; i < 4; i++) {
+    Local<Value> node_field;
+    if (!Nan::Get(js_node, CONTEXT_FIELD_INDEX + i).ToLocal(&node_field)) return false;
+    node->context[i] = Nan::To<uint32_t>(node_field).FromMaybe(0);
   }
+  Local<Value> js_edit_generation;
+  if (!Nan::Get(js_node, EDIT_GENERATION_FIELD_INDEX).ToLocal(&js_edit_generation)) return false;
+  *edit_generation = Nan::To<uint32_t>(js_edit_generation).FromMaybe(0);
+  return true;
 }
 
-static void HasChanges(const Nan::FunctionCallbackInfo<Value> &info) {
-  const Tree *tree = Tree::UnwrapTree(info[0]);
-  TSNode node = UnmarshalNode(tree);
-  if (node.id) {
-    bool result = ts_node_has_changes(node);
-    info.GetReturnValue().Set(Nan::New<Boolean>(result));
+void SetNodeContext(Local<Object> js_node, const TSNode &node, uint32_t edit_generation) {
+  for (unsigned i = 0; i < 4; i++) {
+    Nan::Set(js_node, CONTEXT_FIELD_INDEX + i, Nan::New(node.context[i]));
   }
+  Nan::Set(js_node, EDIT_GENERATION_FIELD_INDEX, Nan::New(edit_generation));
 }
 
-static void HasError(const Nan::FunctionCallbackInfo<Value> &info) {
-  const Tree *tree = Tree::UnwrapTree(info[0]);
-  TSNode node = UnmarshalNode(tree);
+static void ToString(const Nan::FunctionCallbackInfo<Value> &info) {
+  AddonData *data = GetAddonData(info);
+  const Tree *tree = Tree::UnwrapTree(data, info[0]);
+  TSNode node = UnmarshalNode(data, tree);
   if (node.id) {
-    bool result = ts_node_has_error(node);
-    info.GetReturnValue().Set(Nan::New<Boolean>(result));
+    const char *string = ts_node_string(node);
+    info.GetReturnValue().Set(Nan::New(string).ToLocalChecked());
+    free((char *)string);
   }
 }
 
 static void FirstNamedChildForIndex(const Nan::FunctionCallbackInfo<Value> &info) {
-  const Tree *tree = Tree::UnwrapTree(info[0]);
-  TSNode node = UnmarshalNode(tree);
+  AddonData *data = GetAddonData(info);
+  const Tree *tree = Tree::UnwrapTree(data, info[0]);
+  TSNode node = UnmarshalNode(data, tree);
   if (node.id) {
-    Nan::Maybe<uint32_t> byte = ByteCountFromJS(info[1]);
+    Nan::Maybe<uint32_t> byte = ByteCountFromJS(info[1], tree->encoding_);
     if (byte.IsJust()) {
       MarshalNode(info, tree, ts_node_first_named_child_for_byte(node, byte.FromJust()));
       return;
     }
   }
-  MarshalNullNode();
+  MarshalNullNode(data);
 }
 
 static void FirstChildForIndex(const Nan::FunctionCallbackInfo<Value> &info) {
-  const Tree *tree = Tree::UnwrapTree(info[0]);
-  TSNode node = UnmarshalNode(tree);
+  AddonData *data = GetAddonData(info);
+  const Tree *tree = Tree::UnwrapTree(data, info[0]);
+  TSNode node = UnmarshalNode(data, tree);
 
   if (node.id && info.Length() > 1) {
-    Nan::Maybe<uint32_t> byte = ByteCountFromJS(info[1]);
+    Nan::Maybe<uint32_t> byte = ByteCountFromJS(info[1], tree->encoding_);
     if (byte.IsJust()) {
       MarshalNode(info, tree, ts_node_first_child_for_byte(node, byte.FromJust()));
       return;
     }
   }
-  MarshalNullNode();
+  MarshalNullNode(data);
 }
 
 static void NamedDescendantForIndex(const Nan::FunctionCallbackInfo<Value> &info) {
-  const Tree *tree = Tree::UnwrapTree(info[0]);
-  TSNode node = UnmarshalNode(tree);
+  AddonData *data = GetAddonData(info);
+  const Tree *tree = Tree::UnwrapTree(data, info[0]);
+  TSNode node = UnmarshalNode(data, tree);
 
   if (node.id) {
-    Nan::Maybe<uint32_t> maybe_min = ByteCountFromJS(info[1]);
-    Nan::Maybe<uint32_t> maybe_max = ByteCountFromJS(info[2]);
+    Nan::Maybe<uint32_t> maybe_min = ByteCountFromJS(info[1], tree->encoding_);
+    Nan::Maybe<uint32_t> maybe_max = ByteCountFromJS(info[2], tree->encoding_);
     if (maybe_min.IsJust() && maybe_max.IsJust()) {
       uint32_t min = maybe_min.FromJust();
       uint32_t max = maybe_max.FromJust();
@@ -208,16 +234,17 @@ static void NamedDescendantForIndex(const Nan::FunctionCallbackInfo<Value> &info
       return;
     }
   }
-  MarshalNullNode();
+  MarshalNullNode(data);
 }
 
 static void DescendantForIndex(const Nan::FunctionCallbackInfo<Value> &info) {
-  const Tree *tree = Tree::UnwrapTree(info[0]);
-  TSNode node = UnmarshalNode(tree);
+  AddonData *data = GetAddonData(info);
+  const Tree *tree = Tree::UnwrapTree(data, info[0]);
+  TSNode node = UnmarshalNode(data, tree);
 
   if (node.id) {
-    Nan::Maybe<uint32_t> maybe_min = ByteCountFromJS(info[1]);
-    Nan::Maybe<uint32_t> maybe_max = ByteCountFromJS(info[2]);
+    Nan::Maybe<uint32_t> maybe_min = ByteCountFromJS(info[1], tree->encoding_);
+    Nan::Maybe<uint32_t> maybe_max = ByteCountFromJS(info[2], tree->encoding_);
     if (maybe_min.IsJust() && maybe_max.IsJust()) {
       uint32_t min = maybe_min.FromJust();
       uint32_t max = maybe_max.FromJust();
@@ -225,16 +252,17 @@ static void DescendantForIndex(const Nan::FunctionCallbackInfo<Value> &info) {
       return;
     }
   }
-  MarshalNullNode();
+  MarshalNullNode(data);
 }
 
 static void NamedDescendantForPosition(const Nan::FunctionCallbackInfo<Value> &info) {
-  const Tree *tree = Tree::UnwrapTree(info[0]);
-  TSNode node = UnmarshalNode(tree);
+  AddonData *data = GetAddonData(info);
+  const Tree *tree = Tree::UnwrapTree(data, info[0]);
+  TSNode node = UnmarshalNode(data, tree);
 
   if (node.id) {
-    Nan::Maybe<TSPoint> maybe_min = PointFromJS(info[1]);
-    Nan::Maybe<TSPoint> maybe_max = PointFromJS(info[2]);
+    Nan::Maybe<TSPoint> maybe_min = PointFromJS(data, info[1], tree->encoding_);
+    Nan::Maybe<TSPoint> maybe_max = PointFromJS(data, info[2], tree->encoding_);
     if (maybe_min.IsJust() && maybe_max.IsJust()) {
       TSPoint min = maybe_min.FromJust();
       TSPoint max = maybe_max.FromJust();
@@ -242,16 +270,17 @@ static void NamedDescendantForPosition(const Nan::FunctionCallbackInfo<Value> &i
       return;
     }
   }
-  MarshalNullNode();
+  MarshalNullNode(data);
 }
 
 static void DescendantForPosition(const Nan::FunctionCallbackInfo<Value> &info) {
-  const Tree *tree = Tree::UnwrapTree(info[0]);
-  TSNode node = UnmarshalNode(tree);
+  AddonData *data = GetAddonData(info);
+  const Tree *tree = Tree::UnwrapTree(data, info[0]);
+  TSNode node = UnmarshalNode(data, tree);
 
   if (node.id) {
-    Nan::Maybe<TSPoint> maybe_min = PointFromJS(info[1]);
-    Nan::Maybe<TSPoint> maybe_max = PointFromJS(info[2]);
+    Nan::Maybe<TSPoint> maybe_min = PointFromJS(data, info[1], tree->encoding_);
+    Nan::Maybe<TSPoint> maybe_max = PointFromJS(data, info[2], tree->encoding_);
     if (maybe_min.IsJust() && maybe_max.IsJust()) {
       TSPoint min = maybe_min.FromJust();
       TSPoint max = maybe_max.FromJust();
@@ -259,80 +288,53 @@ static void DescendantForPosition(const Nan::FunctionCallbackInfo<Value> &info)
       return;
     }
   }
-  MarshalNullNode();
+  MarshalNullNode(data);
 }
 
 static void Type(const Nan::FunctionCallbackInfo<Value> &info) {
-  const Tree *tree = Tree::UnwrapTree(info[0]);
-  TSNode node = UnmarshalNode(tree);
-
-  if (node.id) {
-    const char *result = ts_node_type(node);
-    info.GetReturnValue().Set(Nan::New(result).ToLocalChecked());
-  }
-}
-
-static void TypeId(const Nan::FunctionCallbackInfo<Value> &info) {
-  const Tree *tree = Tree::UnwrapTree(info[0]);
-  TSNode node = UnmarshalNode(tree);
-
-  if (node.id) {
-    TSSymbol result = ts_node_symbol(node);
-    info.GetReturnValue().Set(Nan::New(result));
-  }
-}
-
-static void IsNamed(const Nan::FunctionCallbackInfo<Value> &info) {
-  const Tree *tree = Tree::UnwrapTree(info[0]);
-  TSNode node = UnmarshalNode(tree);
-
-  if (node.id) {
-    bool result = ts_node_is_named(node);
-    info.GetReturnValue().Set(Nan::New(result));
-  }
-}
-
-static void StartIndex(const Nan::FunctionCallbackInfo<Value> &info) {
-  const Tree *tree = Tree::UnwrapTree(info[0]);
-  TSNode node = UnmarshalNode(tree);
+  AddonData *data = GetAddonData(info);
+  const Tree *tree = Tree::UnwrapTree(data, info[0]);
+  TSNode node = UnmarshalNode(data, tree);
 
   if (node.id) {
-    int32_t result = ts_node_start_byte(node) / 2;
-    info.GetReturnValue().Set(Nan::New<Integer>(result));
+    info.GetReturnValue().Set(language_methods::TypeName(data, ts_tree_language(node.tree), ts_node_symbol(node)));
   }
 }
 
-static void EndIndex(const Nan::FunctionCallbackInfo<Value> &info) {
-  const Tree *tree = Tree::UnwrapTree(info[0]);
-  TSNode node = UnmarshalNode(tree);
+static void Text(const Nan::FunctionCallbackInfo<Value> &info) {
+  AddonData *data = GetAddonData(info);
+  const Tree *tree = Tree::UnwrapTree(data, info[0]);
+  TSNode node = UnmarshalNode(data, tree);
 
   if (node.id) {
-    int32_t result = ts_node_end_byte(node) / 2;
-    info.GetReturnValue().Set(Nan::New<Integer>(result));
+    info.GetReturnValue().Set(tree->SourceTextToJS(ts_node_start_byte(node), ts_node_end_byte(node)));
   }
 }
 
 static void StartPosition(const Nan::FunctionCallbackInfo<Value> &info) {
-  const Tree *tree = Tree::UnwrapTree(info[0]);
-  TSNode node = UnmarshalNode(tree);
+  AddonData *data = GetAddonData(info);
+  const Tree *tree = Tree::UnwrapTree(data, info[0]);
+  TSNode node = UnmarshalNode(data, tree);
 
   if (node.id) {
-    TransferPoint(ts_node_start_point(node));
+    TransferPoint(data, ts_node_start_point(node), tree->encoding_);
   }
 }
 
 static void EndPosition(const Nan::FunctionCallbackInfo<Value> &info) {
-  const Tree *tree = Tree::UnwrapTree(info[0]);
-  TSNode node = UnmarshalNode(tree);
+  AddonData *data = GetAddonData(info);
+  const Tree *tree = Tree::UnwrapTree(data, info[0]);
+  TSNode node = UnmarshalNode(data, tree);
 
   if (node.id) {
-    TransferPoint(ts_node_end_point(node));
+    TransferPoint(data, ts_node_end_point(node), tree->encoding_);
   }
 }
 
 static void Child(const Nan::FunctionCallbackInfo<Value> &info) {
-  const Tree *tree = Tree::UnwrapTree(info[0]);
-  TSNode node = UnmarshalNode(tree);
+  AddonData *data = GetAddonData(info);
+  const Tree *tree = Tree::UnwrapTree(data, info[0]);
+  TSNode node = UnmarshalNode(data, tree);
 
   if (node.id) {
     if (!info[1]->IsUint32()) {
@@ -343,12 +345,13 @@ static void Child(const Nan::FunctionCallbackInfo<Value> &info) {
     MarshalNode(info, tree, ts_node_child(node, index));
     return;
   }
-  MarshalNullNode();
+  MarshalNullNode(data);
 }
 
 static void NamedChild(const Nan::FunctionCallbackInfo<Value> &info) {
-  const Tree *tree = Tree::UnwrapTree(info[0]);
-  TSNode node = UnmarshalNode(tree);
+  AddonData *data = GetAddonData(info);
+  const Tree *tree = Tree::UnwrapTree(data, info[0]);
+  TSNode node = UnmarshalNode(data, tree);
 
   if (node.id) {
     if (!info[1]->IsUint32()) {
@@ -359,50 +362,35 @@ static void NamedChild(const Nan::FunctionCallbackInfo<Value> &info) {
     MarshalNode(info, tree, ts_node_named_child(node, index));
     return;
   }
-  MarshalNullNode();
-}
-
-static void ChildCount(const Nan::FunctionCallbackInfo<Value> &info) {
-  const Tree *tree = Tree::UnwrapTree(info[0]);
-  TSNode node = UnmarshalNode(tree);
-
-  if (node.id) {
-    info.GetReturnValue().Set(Nan::New(ts_node_child_count(node)));
-  }
-}
-
-static void NamedChildCount(const Nan::FunctionCallbackInfo<Value> &info) {
-  const Tree *tree = Tree::UnwrapTree(info[0]);
-  TSNode node = UnmarshalNode(tree);
-
-  if (node.id) {
-    info.GetReturnValue().Set(Nan::New(ts_node_named_child_count(node)));
-  }
+  MarshalNullNode(data);
 }
 
 static void FirstChild(const Nan::FunctionCallbackInfo<Value> &info) {
-  const Tree *tree = Tree::UnwrapTree(info[0]);
-  TSNode node = UnmarshalNode(tree);
+  AddonData *data = GetAddonData(info);
+  const Tree *tree = Tree::UnwrapTree(data, info[0]);
+  TSNode node = UnmarshalNode(data, tree);
   if (node.id) {
     MarshalNode(info, tree, ts_node_child(node, 0));
     return;
   }
-  MarshalNullNode();
+  MarshalNullNode(data);
 }
 
 static void FirstNamedChild(const Nan::FunctionCallbackInfo<Value> &info) {
-  const Tree *tree = Tree::UnwrapTree(info[0]);
-  TSNode node = UnmarshalNode(tree);
+  AddonData *data = GetAddonData(info);
+  const Tree *tree = Tree::UnwrapTree(data, info[0]);
+  TSNode node = UnmarshalNode(data, tree);
   if (node.id) {
     MarshalNode(info, tree, ts_node_named_child(node, 0));
     return;
   }
-  MarshalNullNode();
+  MarshalNullNode(data);
 }
 
 static void LastChild(const Nan::FunctionCallbackInfo<Value> &info) {
-  const Tree *tree = Tree::UnwrapTree(info[0]);
-  TSNode node = UnmarshalNode(tree);
+  AddonData *data = GetAddonData(info);
+  const Tree *tree = Tree::UnwrapTree(data, info[0]);
+  TSNode node = UnmarshalNode(data, tree);
   if (node.id) {
     uint32_t child_count = ts_node_child_count(node);
     if (child_count > 0) {
@@ -410,12 +398,13 @@ static void LastChild(const Nan::FunctionCallbackInfo<Value> &info) {
       return;
     }
   }
-  MarshalNullNode();
+  MarshalNullNode(data);
 }
 
 static void LastNamedChild(const Nan::FunctionCallbackInfo<Value> &info) {
-  const Tree *tree = Tree::UnwrapTree(info[0]);
-  TSNode node = UnmarshalNode(tree);
+  AddonData *data = GetAddonData(info);
+  const Tree *tree = Tree::UnwrapTree(data, info[0]);
+  TSNode node = UnmarshalNode(data, tree);
   if (node.id) {
     uint32_t child_count = ts_node_named_child_count(node);
     if (child_count > 0) {
@@ -423,188 +412,137 @@ static void LastNamedChild(const Nan::FunctionCallbackInfo<Value> &info) {
       return;
     }
   }
-  MarshalNullNode();
+  MarshalNullNode(data);
 }
 
 static void Parent(const Nan::FunctionCallbackInfo<Value> &info) {
-  const Tree *tree = Tree::UnwrapTree(info[0]);
-  TSNode node = UnmarshalNode(tree);
+  AddonData *data = GetAddonData(info);
+  const Tree *tree = Tree::UnwrapTree(data, info[0]);
+  TSNode node = UnmarshalNode(data, tree);
   if (node.id) {
     MarshalNode(info, tree, ts_node_parent(node));
     return;
   }
-  MarshalNullNode();
+  MarshalNullNode(data);
 }
 
 static void NextSibling(const Nan::FunctionCallbackInfo<Value> &info) {
-  const Tree *tree = Tree::UnwrapTree(info[0]);
-  TSNode node = UnmarshalNode(tree);
+  AddonData *data = GetAddonData(info);
+  const Tree *tree = Tree::UnwrapTree(data, info[0]);
+  TSNode node = UnmarshalNode(data, tree);
   if (node.id) {
     MarshalNode(info, tree, ts_node_next_sibling(node));
     return;
   }
-  MarshalNullNode();
+  MarshalNullNode(data);
 }
 
 static void NextNamedSibling(const Nan::FunctionCallbackInfo<Value> &info) {
-  const Tree *tree = Tree::UnwrapTree(info[0]);
-  TSNode node = UnmarshalNode(tree);
+  AddonData *data = GetAddonData(info);
+  const Tree *tree = Tree::UnwrapTree(data, info[0]);
+  TSNode node = UnmarshalNode(data, tree);
   if (node.id) {
     MarshalNode(info, tree, ts_node_next_named_sibling(node));
     return;
   }
-  MarshalNullNode();
+  MarshalNullNode(data);
 }
 
 static void PreviousSibling(const Nan::FunctionCallbackInfo<Value> &info) {
-  const Tree *tree = Tree::UnwrapTree(info[0]);
-  TSNode node = UnmarshalNode(tree);
+  AddonData *data = GetAddonData(info);
+  const Tree *tree = Tree::UnwrapTree(data, info[0]);
+  TSNode node = UnmarshalNode(data, tree);
   if (node.id) {
     MarshalNode(info, tree, ts_node_prev_sibling(node));
     return;
   }
-  MarshalNullNode();
+  MarshalNullNode(data);
 }
 
 static void PreviousNamedSibling(const Nan::FunctionCallbackInfo<Value> &info) {
-  const Tree *tree = Tree::UnwrapTree(info[0]);
-  TSNode node = UnmarshalNode(tree);
+  AddonData *data = GetAddonData(info);
+  const Tree *tree = Tree::UnwrapTree(data, info[0]);
+  TSNode node = UnmarshalNode(data, tree);
   if (node.id) {
     MarshalNode(info, tree, ts_node_prev_named_sibling(node));
     return;
   }
-  MarshalNullNode();
-}
-
-struct SymbolSet {
-  std::basic_string<TSSymbol> symbols;
-  void add(TSSymbol symbol) { symbols += symbol; }
-  bool contains(TSSymbol symbol) { return symbols.find(symbol) != symbols.npos; }
-};
-
-bool symbol_set_from_js(SymbolSet *symbols, const Local<Value> &value, const TSLanguage *language) {
-  if (!value->IsArray()) {
-    Nan::ThrowTypeError("Argument must be a string or array of strings");
-    return false;
-  }
-
-  unsigned symbol_count = ts_language_symbol_count(language);
-
-  Local<Array> js_types = Local<Array>::Cast(value);
-  for (unsigned i = 0, n = js_types->Length(); i < n; i++) {
-    Local<Value> js_node_type_value;
-    if (Nan::Get(js_types, i).ToLocal(&js_node_type_value)) {
-      Local<String> js_node_type;
-      if (Nan::To<String>(js_node_type_value).ToLocal(&js_node_type)) {
-        auto length = js_node_type->Utf8Length(
-          #if NODE_MAJOR_VERSION >= 12
-            Isolate::GetCurrent()
-          #endif
-        );
-
-        std::string node_type(length, '\0');
-        js_node_type->WriteUtf8(
-
-          // Nan doesn't wrap this functionality
-          #if NODE_MAJOR_VERSION >= 12
-            Isolate::GetCurrent(),
-          #endif
-
-          &node_type[0]
-        );
-
-        if (node_type == "ERROR") {
-          symbols->add(static_cast<TSSymbol>(-1));
-        } else {
-          for (TSSymbol j = 0; j < symbol_count; j++) {
-            if (node_type == ts_language_symbol_name(language, j)) {
-              symbols->add(j);
-            }
-          }
-        }
-
-        continue;
-      }
-    }
-
-    Nan::ThrowTypeError("Argument must be a string or array of strings");
-    return false;
-  }
-
-  return true;
+  MarshalNullNode(data);
 }
 
 static void Children(const Nan::FunctionCallbackInfo<Value> &info) {
-  const Tree *tree = Tree::UnwrapTree(info[0]);
-  TSNode node = UnmarshalNode(tree);
+  AddonData *data = GetAddonData(info);
+  const Tree *tree = Tree::UnwrapTree(data, info[0]);
+  TSNode node = UnmarshalNode(data, tree);
   if (!node.id) return;
 
   vector<TSNode> result;
-  ts_tree_cursor_reset(&scratch_cursor, node);
-  if (ts_tree_cursor_goto_first_child(&scratch_cursor)) {
+  ts_tree_cursor_reset(&data->scratch_cursor, node);
+  if (ts_tree_cursor_goto_first_child(&data->scratch_cursor)) {
     do {
-      TSNode child = ts_tree_cursor_current_node(&scratch_cursor);
+      TSNode child = ts_tree_cursor_current_node(&data->scratch_cursor);
       result.push_back(child);
-    } while (ts_tree_cursor_goto_next_sibling(&scratch_cursor));
+    } while (ts_tree_cursor_goto_next_sibling(&data->scratch_cursor));
   }
 
   MarshalNodes(info, tree, result.data(), result.size());
 }
 
 static void NamedChildren(const Nan::FunctionCallbackInfo<Value> &info) {
-  const Tree *tree = Tree::UnwrapTree(info[0]);
-  TSNode node = UnmarshalNode(tree);
+  AddonData *data = GetAddonData(info);
+  const Tree *tree = Tree::UnwrapTree(data, info[0]);
+  TSNode node = UnmarshalNode(data, tree);
   if (!node.id) return;
 
   vector<TSNode> result;
-  ts_tree_cursor_reset(&scratch_cursor, node);
-  if (ts_tree_cursor_goto_first_child(&scratch_cursor)) {
+  ts_tree_cursor_reset(&data->scratch_cursor, node);
+  if (ts_tree_cursor_goto_first_child(&data->scratch_cursor)) {
     do {
-      TSNode child = ts_tree_cursor_current_node(&scratch_cursor);
+      TSNode child = ts_tree_cursor_current_node(&data->scratch_cursor);
       if (ts_node_is_named(child)) {
         result.push_back(child);
       }
-    } while (ts_tree_cursor_goto_next_sibling(&scratch_cursor));
+    } while (ts_tree_cursor_goto_next_sibling(&data->scratch_cursor));
   }
 
   MarshalNodes(info, tree, result.data(), result.size());
 }
 
 static void DescendantsOfType(const Nan::FunctionCallbackInfo<Value> &info) {
-  const Tree *tree = Tree::UnwrapTree(info[0]);
-  TSNode node = UnmarshalNode(tree);
+  AddonData *data = GetAddonData(info);
+  const Tree *tree = Tree::UnwrapTree(data, info[0]);
+  TSNode node = UnmarshalNode(data, tree);
   if (!node.id) return;
 
-  SymbolSet symbols;
-  if (!symbol_set_from_js(&symbols, info[1], ts_tree_language(node.tree))) return;
+  NodeTypeFilter filter(info[1], false);
 
   TSPoint start_point = {0, 0};
   TSPoint end_point = {UINT32_MAX, UINT32_MAX};
 
   if (info.Length() > 2 && info[2]->IsObject()) {
-    auto maybe_start_point = PointFromJS(info[2]);
+    auto maybe_start_point = PointFromJS(data, info[2], tree->encoding_);
     if (maybe_start_point.IsNothing()) return;
     start_point = maybe_start_point.FromJust();
   }
 
   if (info.Length() > 3 && info[3]->IsObject()) {
-    auto maybe_end_point = PointFromJS(info[3]);
+    auto maybe_end_point = PointFromJS(data, info[3], tree->encoding_);
     if (maybe_end_point.IsNothing()) return;
     end_point = maybe_end_point.FromJust();
   }
 
   vector<TSNode> found;
-  ts_tree_cursor_reset(&scratch_cursor, node);
+  ts_tree_cursor_reset(&data->scratch_cursor, node);
   auto already_visited_children = false;
   while (true) {
-    TSNode descendant = ts_tree_cursor_current_node(&scratch_cursor);
+    TSNode descendant = ts_tree_cursor_current_node(&data->scratch_cursor);
 
     if (!already_visited_children) {
       if (ts_node_end_point(descendant) <= start_point) {
-        if (ts_tree_cursor_goto_next_sibling(&scratch_cursor)) {
+        if (ts_tree_cursor_goto_next_sibling(&data->scratch_cursor)) {
           already_visited_children = false;
         } else {
-          if (!ts_tree_cursor_goto_parent(&scratch_cursor)) break;
+          if (!ts_tree_cursor_goto_parent(&data->scratch_cursor)) break;
           already_visited_children = true;
         }
         continue;
@@ -612,23 +550,23 @@ static void DescendantsOfType(const Nan::FunctionCallbackInfo<Value> &info) {
 
       if (end_point <= ts_node_start_point(descendant)) break;
 
-      if (symbols.contains(ts_node_symbol(descendant))) {
+      if (filter.Matches(descendant)) {
         found.push_back(descendant);
       }
 
-      if (ts_tree_cursor_goto_first_child(&scratch_cursor)) {
+      if (ts_tree_cursor_goto_first_child(&data->scratch_cursor)) {
         already_visited_children = false;
-      } else if (ts_tree_cursor_goto_next_sibling(&scratch_cursor)) {
+      } else if (ts_tree_cursor_goto_next_sibling(&data->scratch_cursor)) {
         already_visited_children = false;
       } else {
-        if (!ts_tree_cursor_goto_parent(&scratch_cursor)) break;
+        if (!ts_tree_cursor_goto_parent(&data->scratch_cursor)) break;
         already_visited_children = true;
       }
     } else {
-      if (ts_tree_cursor_goto_next_sibling(&scratch_cursor)) {
+      if (ts_tree_cursor_goto_next_sibling(&data->scratch_cursor)) {
         already_visited_children = false;
       } else {
-        if (!ts_tree_cursor_goto_parent(&scratch_cursor)) break;
+        if (!ts_tree_cursor_goto_parent(&data->scratch_cursor)) break;
       }
     }
   }
@@ -637,8 +575,9 @@ static void DescendantsOfType(const Nan::FunctionCallbackInfo<Value> &info) {
 }
 
 static void ChildNodesForFieldId(const Nan::FunctionCallbackInfo<Value> &info) {
-  const Tree *tree = Tree::UnwrapTree(info[0]);
-  TSNode node = UnmarshalNode(tree);
+  AddonData *data = GetAddonData(info);
+  const Tree *tree = Tree::UnwrapTree(data, info[0]);
+  TSNode node = UnmarshalNode(data, tree);
   if (!node.id) return;
 
   auto maybe_field_id = Nan::To<uint32_t>(info[1]);
@@ -649,22 +588,23 @@ static void ChildNodesForFieldId(const Nan::FunctionCallbackInfo<Value> &info) {
   uint32_t field_id = maybe_field_id.FromJust();
 
   vector<TSNode> result;
-  ts_tree_cursor_reset(&scratch_cursor, node);
-  if (ts_tree_cursor_goto_first_child(&scratch_cursor)) {
+  ts_tree_cursor_reset(&data->scratch_cursor, node);
+  if (ts_tree_cursor_goto_first_child(&data->scratch_cursor)) {
     do {
-      TSNode child = ts_tree_cursor_current_node(&scratch_cursor);
-      if (ts_tree_cursor_current_field_id(&scratch_cursor) == field_id) {
+      TSNode child = ts_tree_cursor_current_node(&data->scratch_cursor);
+      if (ts_tree_cursor_current_field_id(&data->scratch_cursor) == field_id) {
         result.push_back(child);
       }
-    } while (ts_tree_cursor_goto_next_sibling(&scratch_cursor));
+    } while (ts_tree_cursor_goto_next_sibling(&data->scratch_cursor));
   }
 
   MarshalNodes(info, tree, result.data(), result.size());
 }
 
 static void ChildNodeForFieldId(const Nan::FunctionCallbackInfo<Value> &info) {
-  const Tree *tree = Tree::UnwrapTree(info[0]);
-  TSNode node = UnmarshalNode(tree);
+  AddonData *data = GetAddonData(info);
+  const Tree *tree = Tree::UnwrapTree(data, info[0]);
+  TSNode node = UnmarshalNode(data, tree);
 
   if (node.id) {
     auto maybe_field_id = Nan::To<uint32_t>(info[1]);
@@ -676,53 +616,181 @@ static void ChildNodeForFieldId(const Nan::FunctionCallbackInfo<Value> &info) {
     MarshalNode(info, tree, ts_node_child_by_field_id(node, field_id));
     return;
   }
-  MarshalNullNode();
+  MarshalNullNode(data);
 }
 
 static void Closest(const Nan::FunctionCallbackInfo<Value> &info) {
-  const Tree *tree = Tree::UnwrapTree(info[0]);
-  TSNode node = UnmarshalNode(tree);
+  AddonData *data = GetAddonData(info);
+  const Tree *tree = Tree::UnwrapTree(data, info[0]);
+  TSNode node = UnmarshalNode(data, tree);
   if (!node.id) return;
 
-  SymbolSet symbols;
-  if (!symbol_set_from_js(&symbols, info[1], ts_tree_language(node.tree))) return;
+  NodeTypeFilter filter(info[1], false);
 
   for (;;) {
     TSNode parent = ts_node_parent(node);
     if (!parent.id) break;
-    if (symbols.contains(ts_node_symbol(parent))) {
+    if (filter.Matches(parent)) {
       MarshalNode(info, tree, parent);
       return;
     }
     node = parent;
   }
 
-  MarshalNullNode();
+  MarshalNullNode(data);
+}
+
+static void Select(const Nan::FunctionCallbackInfo<Value> &info) {
+  AddonData *data = GetAddonData(info);
+  const Tree *tree = Tree::UnwrapTree(data, info[0]);
+  TSNode node = UnmarshalNode(data, tree);
+  if (!node.id) return;
+
+  const Selector *selector = Selector::UnwrapSelector(data, info[1]);
+  if (!selector) {
+    Nan::ThrowTypeError("Second argument must be a Selector");
+    return;
+  }
+  if (selector->language_ != ts_tree_language(node.tree)) {
+    Nan::ThrowError("Selector belongs to a different language");
+    return;
+  }
+
+  uint32_t limit = Nan::To<uint32_t>(info[2]).FromMaybe(0);
+  vector<TSNode> result;
+  selector->Select(&data->scratch_cursor, node, limit, &result);
+  MarshalNodes(info, tree, result.data(), result.size());
 }
 
 static void Walk(const Nan::FunctionCallbackInfo<Value> &info) {
-  const Tree *tree = Tree::UnwrapTree(info[0]);
-  TSNode node = UnmarshalNode(tree);
+  AddonData *data = GetAddonData(info);
+  const Tree *tree = Tree::UnwrapTree(data, info[0]);
+  TSNode node = UnmarshalNode(data, tree);
   TSTreeCursor cursor = ts_tree_cursor_new(node);
-  info.GetReturnValue().Set(TreeCursor::NewInstance(cursor));
+  info.GetReturnValue().Set(TreeCursor::NewInstance(data, cursor, tree->encoding_));
+}
+
+static uint32_t start_index(const Tree *tree, TSNode node) {
+  return ts_node_start_byte(node) / BytesPerCharacter(tree->encoding_);
+}
+
+static uint32_t end_index(const Tree *tree, TSNode node) {
+  return ts_node_end_byte(node) / BytesPerCharacter(tree->encoding_);
+}
+
+static uint32_t type_id(const Tree *, TSNode node) { return ts_node_symbol(node); }
+static bool is_named(const Tree *, TSNode node) { return ts_node_is_named(node); }
+static bool is_missing(const Tree *, TSNode node) { return ts_node_is_missing(node); }
+static bool has_changes(const Tree *, TSNode node) { return ts_node_has_changes(node); }
+static bool has_error(const Tree *, TSNode node) { return ts_node_has_error(node); }
+static uint32_t child_count(const Tree *, TSNode node) { return ts_node_child_count(node); }
+static uint32_t named_child_count(const Tree *, TSNode node) { return ts_node_named_child_count(node); }
+
+// The simplest getters are methods of Tree.prototype that take the node's
+// fields as arguments, so that they don't need the transfer buffer, and V8
+// checks the receiver through the method's signature. Both the regular and
+// the fast callback return the default value of `T` for a null node, and
+// neither updates the wrapper of a stale node, so that the getters are free
+// of side effects; the wrapper catches up the next time it is unmarshalled.
+template <typename T, T (*getter)(const Tree *, TSNode)>
+static void NodeGetter(const v8::FunctionCallbackInfo<Value> &info) {
+  const Tree *tree = Nan::ObjectWrap::Unwrap<Tree>(info.This());
+  if (!tree || !tree->tree_) {
+    info.GetReturnValue().Set(T());
+    return;
+  }
+
+  uint32_t fields[FIELD_COUNT_PER_NODE];
+  for (unsigned i = 0; i < FIELD_COUNT_PER_NODE; i++) {
+    fields[i] = Nan::To<uint32_t>(info[i]).FromMaybe(0);
+  }
+  TSNode node = node_from_fields(tree, fields, false);
+  info.GetReturnValue().Set(node.id ? getter(tree, node) : T());
+}
+
+#if NODE_TREE_SITTER_FAST_API
+
+// Fast API callbacks can't create handles or touch JS objects.
+template <typename T, T (*getter)(const Tree *, TSNode)>
+static T FastNodeGetter(Local<Object> receiver, uint32_t id_low, uint32_t id_high,
+                        uint32_t context0, uint32_t context1, uint32_t context2,
+                        uint32_t context3, uint32_t edit_generation) {
+  const Tree *tree = Nan::ObjectWrap::Unwrap<Tree>(receiver);
+  if (!tree || !tree->tree_) return T();
+
+  uint32_t fields[FIELD_COUNT_PER_NODE] = {
+    id_low, id_high, context0, context1, context2, context3, edit_generation
+  };
+  TSNode node = node_from_fields(tree, fields, false);
+  return node.id ? getter(tree, node) : T();
 }
 
-void Init(Local<Object> exports) {
+struct NodeGetterPair {
+  const char *name;
+  v8::FunctionCallback callback;
+  v8::CFunction fast_callback;
+};
+
+#define NODE_GETTER(name, type, getter) \
+  {name, NodeGetter<type, getter>, v8::CFunction::Make(FastNodeGetter<type, getter>)}
+
+#else
+
+struct NodeGetterPair {
+  const char *name;
+  v8::FunctionCallback callback;
+};
+
+#define NODE_GETTER(name, type, getter) {name, NodeGetter<type, getter>}
+
+#endif
+
+void InitNodeGetters(Local<FunctionTemplate> tree_template) {
+  static const NodeGetterPair getters[] = {
+    NODE_GETTER("_nodeStartIndex", uint32_t, start_index),
+    NODE_GETTER("_nodeEndIndex", uint32_t, end_index),
+    NODE_GETTER("_nodeTypeId", uint32_t, type_id),
+    NODE_GETTER("_nodeIsNamed", bool, is_named),
+    NODE_GETTER("_nodeIsMissing", bool, is_missing),
+    NODE_GETTER("_nodeHasChanges", bool, has_changes),
+    NODE_GETTER("_nodeHasError", bool, has_error),
+    NODE_GETTER("_nodeChildCount", uint32_t, child_count),
+    NODE_GETTER("_nodeNamedChildCount", uint32_t, named_child_count),
+  };
+
+  Isolate *isolate = Isolate::GetCurrent();
+  Local<Signature> signature = Signature::New(isolate, tree_template);
+  for (size_t i = 0; i < length_of_array(getters); i++) {
+    Local<FunctionTemplate> method = FunctionTemplate::New(
+      isolate,
+      getters[i].callback,
+      Local<Value>(),
+      signature
+      #if NODE_TREE_SITTER_FAST_API
+        , 0,
+        ConstructorBehavior::kThrow,
+        SideEffectType::kHasNoSideEffect,
+        &getters[i].fast_callback
+      #endif
+    );
+    tree_template->PrototypeTemplate()->Set(Nan::New(getters[i].name).ToLocalChecked(), method);
+  }
+}
+
+#undef NODE_GETTER
+
+void Init(Local<Object> exports, AddonData *data) {
   Local<Object> result = Nan::New<Object>();
+  Local<External> data_ext = Nan::New<External>(data);
 
   FunctionPair methods[] = {
-    {"startIndex", StartIndex},
-    {"endIndex", EndIndex},
+    {"text", Text},
     {"type", Type},
-    {"typeId", TypeId},
-    {"isNamed", IsNamed},
     {"parent", Parent},
     {"child", Child},
     {"namedChild", NamedChild},
     {"children", Children},
     {"namedChildren", NamedChildren},
-    {"childCount", ChildCount},
-    {"namedChildCount", NamedChildCount},
     {"firstChild", FirstChild},
     {"lastChild", LastChild},
     {"firstNamedChild", FirstNamedChild},
@@ -733,7 +801,6 @@ void Init(Local<Object> exports) {
     {"previousNamedSibling", PreviousNamedSibling},
     {"startPosition", StartPosition},
     {"endPosition", EndPosition},
-    {"isMissing", IsMissing},
     {"toString", ToString},
     {"firstChildForIndex", FirstChildForIndex},
     {"firstNamedChildForIndex", FirstNamedChildForIndex},
@@ -741,11 +808,10 @@ void Init(Local<Object> exports) {
     {"namedDescendantForIndex", NamedDescendantForIndex},
     {"descendantForPosition", DescendantForPosition},
     {"namedDescendantForPosition", NamedDescendantForPosition},
-    {"hasChanges", HasChanges},
-    {"hasError", HasError},
     {"descendantsOfType", DescendantsOfType},
     {"walk", Walk},
     {"closest", Closest},
+    {"select", Select},
     {"childNodeForFieldId", ChildNodeForFieldId},
     {"childNodesForFieldId", ChildNodesForFieldId},
   };
@@ -754,12 +820,12 @@ void Init(Local<Object> exports) {
     Nan::Set(
       result,
       Nan::New(methods[i].name).ToLocalChecked(),
-      Nan::GetFunction(Nan::New<FunctionTemplate>(methods[i].callback)).ToLocalChecked()
+      Nan::GetFunction(Nan::New<FunctionTemplate>(methods[i].callback, data_ext)).ToLocalChecked()
     );
   }
 
-  module_exports.Reset(exports);
-  setup_transfer_buffer(1);
+  data->module_exports.Reset(exports);
+  setup_transfer_buffer(data, 1);
 
   Nan::Set(exports, Nan::New("NodeMethods").ToLocalChecked(), result);
 }
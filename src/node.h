@@ -5,6 +5,7 @@
 #include <v8.h>
 #include <node_object_wrap.h>
 #include <tree_sitter/api.h>
+#include "./addon_data.h"
 #include "./tree.h"
 
 using namespace v8;
@@ -12,11 +13,14 @@ using namespace v8;
 namespace node_tree_sitter {
 namespace node_methods {
 
-void Init(v8::Local<v8::Object>);
+void Init(v8::Local<v8::Object>, AddonData *);
+void InitNodeGetters(v8::Local<v8::FunctionTemplate> tree_template);
 void MarshalNode(const Nan::FunctionCallbackInfo<v8::Value> &info, const Tree *, TSNode);
 Local<Value> GetMarshalNode(const Nan::FunctionCallbackInfo<Value> &info, const Tree *tree, TSNode node);
 Local<Value> GetMarshalNodes(const Nan::FunctionCallbackInfo<Value> &info, const Tree *tree, const TSNode *nodes, uint32_t node_count);
-TSNode UnmarshalNode(const Tree *tree);
+TSNode UnmarshalNode(AddonData *data, const Tree *tree);
+bool GetNodeContext(v8::Local<v8::Object> js_node, TSNode *, uint32_t *edit_generation);
+void SetNodeContext(v8::Local<v8::Object> js_node, const TSNode &, uint32_t edit_generation);
 
 static inline const void *UnmarshalNodeId(const uint32_t *buffer) {
   const void *result;
@@ -2,14 +2,26 @@
 #include <string>
 #include <vector>
 #include <climits>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
 #include <v8.h>
 #include <nan.h>
+#include "./addon_data.h"
 #include "./conversions.h"
 #include "./language.h"
 #include "./logger.h"
 #include "./tree.h"
 #include "./util.h"
 #include <cmath>
+#include <unordered_set>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
 
 namespace node_tree_sitter {
 
@@ -17,12 +29,85 @@ using namespace v8;
 using std::vector;
 using std::pair;
 
-Nan::Persistent<Function> Parser::constructor;
+static uint64_t wall_time_now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()
+  ).count();
+}
+
+// The CPU time used by the current thread, so that parses on the thread pool
+// are measured separately from each other.
+static uint64_t cpu_time_now() {
+#ifdef _WIN32
+  FILETIME creation_time, exit_time, kernel_time, user_time;
+  if (!GetThreadTimes(GetCurrentThread(), &creation_time, &exit_time, &kernel_time, &user_time)) return 0;
+  ULARGE_INTEGER kernel, user;
+  kernel.LowPart = kernel_time.dwLowDateTime;
+  kernel.HighPart = kernel_time.dwHighDateTime;
+  user.LowPart = user_time.dwLowDateTime;
+  user.HighPart = user_time.dwHighDateTime;
+  return (kernel.QuadPart + user.QuadPart) * 100;
+#else
+  struct timespec time;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) != 0) return 0;
+  return (uint64_t)time.tv_sec * 1000000000 + time.tv_nsec;
+#endif
+}
+
+// Counts the nodes of a new tree that weren't reused from the old tree. The
+// ids of the old tree's nodes are collected first, so that the reused subtrees
+// of the new tree can be recognized and skipped in a single walk.
+static uint64_t count_new_nodes(const TSTree *old_tree, const TSTree *new_tree) {
+  std::unordered_set<const void *> old_ids;
+  TSTreeCursor cursor = ts_tree_cursor_new(ts_tree_root_node(old_tree));
+  for (bool done = false; !done;) {
+    old_ids.insert(ts_tree_cursor_current_node(&cursor).id);
+    if (ts_tree_cursor_goto_first_child(&cursor)) continue;
+    while (!ts_tree_cursor_goto_next_sibling(&cursor)) {
+      if (!ts_tree_cursor_goto_parent(&cursor)) {
+        done = true;
+        break;
+      }
+    }
+  }
+
+  ts_tree_cursor_reset(&cursor, ts_tree_root_node(new_tree));
+  uint64_t count = 0;
+  for (;;) {
+    if (!old_ids.count(ts_tree_cursor_current_node(&cursor).id)) {
+      count++;
+      if (ts_tree_cursor_goto_first_child(&cursor)) continue;
+    }
+    while (!ts_tree_cursor_goto_next_sibling(&cursor)) {
+      if (!ts_tree_cursor_goto_parent(&cursor)) {
+        ts_tree_cursor_delete(&cursor);
+        return count;
+      }
+    }
+  }
+}
+
+static void finish_parse_stats(
+  ParseStats *stats,
+  const TSTree *old_tree,
+  const TSTree *tree,
+  uint64_t wall_start_time,
+  uint64_t cpu_start_time
+) {
+  stats->parse_count++;
+  if (old_tree) {
+    stats->incremental_parse_count++;
+    if (tree && stats->counts_new_nodes) stats->new_node_count += count_new_nodes(old_tree, tree);
+  }
+  stats->wall_time += wall_time_now() - wall_start_time;
+  stats->cpu_time += cpu_time_now() - cpu_start_time;
+}
 
 class CallbackInput {
  public:
-  CallbackInput(v8::Local<v8::Function> callback, v8::Local<v8::Value> js_buffer_size)
-    : callback(callback),
+  CallbackInput(AddonData *data, v8::Local<v8::Function> callback, v8::Local<v8::Value> js_buffer_size)
+    : data(data),
+      callback(callback),
       byte_offset(0),
       partial_string_offset(0) {
     uint32_t buffer_size = Nan::To<uint32_t>(js_buffer_size).FromMaybe(0);
@@ -38,6 +123,9 @@ class CallbackInput {
     return result;
   }
 
+  // Where to count the reads and the time spent in the callback, if set.
+  ParseStats *stats = nullptr;
+
  private:
   static const char * Read(void *payload, uint32_t byte, TSPoint position, uint32_t *bytes_read) {
     CallbackInput *reader = (CallbackInput *)payload;
@@ -57,9 +145,14 @@ class CallbackInput {
     } else {
       Local<Function> callback = Nan::New(reader->callback);
       uint32_t utf16_unit = byte / 2;
-      Local<Value> argv[2] = { Nan::New<Number>(utf16_unit), PointToJS(position) };
+      Local<Value> argv[2] = { Nan::New<Number>(utf16_unit), PointToJS(reader->data, position, TSInputEncodingUTF16) };
       TryCatch try_catch(Isolate::GetCurrent());
+      uint64_t call_start_time = reader->stats ? wall_time_now() : 0;
       auto maybe_result_value = Nan::Call(callback, GetGlobal(callback), 2, argv);
+      if (reader->stats) {
+        reader->stats->read_count++;
+        reader->stats->callback_time += wall_time_now() - call_start_time;
+      }
       if (try_catch.HasCaught()) return nullptr;
 
       Local<Value> result_value;
@@ -82,6 +175,7 @@ class CallbackInput {
     );
     int end = start + utf16_units_read;
     *bytes_read = 2 * utf16_units_read;
+    if (reader->stats) reader->stats->bytes_read += *bytes_read;
 
     reader->byte_offset += *bytes_read;
 
@@ -96,6 +190,7 @@ class CallbackInput {
     return (const char *)reader->buffer.data();
   }
 
+  AddonData *data;
   Nan::Persistent<v8::Function> callback;
   std::vector<uint16_t> buffer;
   size_t byte_offset;
@@ -103,8 +198,195 @@ class CallbackInput {
   size_t partial_string_offset;
 };
 
-void Parser::Init(Local<Object> exports) {
-  Local<FunctionTemplate> tpl = Nan::New<FunctionTemplate>(New);
+// Serves the parser from a flat buffer of text: either a UTF-16 copy of a
+// string, or the contents of a UTF-8 Buffer. Each read returns everything
+// after the requested offset, so the parser rarely needs to read more than
+// once, and never needs to call back into JavaScript.
+class TextInput {
+ public:
+  TextInput() : data(nullptr), length(0), encoding(TSInputEncodingUTF16) {}
+
+  TSInput Input() {
+    TSInput result;
+    result.payload = (void *)this;
+    result.encoding = encoding;
+    result.read = Read;
+    return result;
+  }
+
+  void ReadString(Local<String> string) {
+    text.resize(string->Length());
+    if (!text.empty()) {
+      string->Write(
+
+        // Nan doesn't wrap this functionality
+        #if NODE_MAJOR_VERSION >= 12
+          Isolate::GetCurrent(),
+        #endif
+
+        text.data(),
+        0,
+        text.size(),
+        String::NO_NULL_TERMINATION
+      );
+    }
+    UseText();
+  }
+
+  void ReadCallback(CallbackInput &callback_input) {
+    TSInput input = callback_input.Input();
+    TSPoint position = {0, 0};
+    for (;;) {
+      uint32_t bytes_read = 0;
+      const char *chunk = input.read(input.payload, text.size() * 2, position, &bytes_read);
+      if (!chunk || bytes_read == 0) break;
+
+      const uint16_t *units = (const uint16_t *)chunk;
+      for (uint32_t i = 0, n = bytes_read / 2; i < n; i++) {
+        text.push_back(units[i]);
+        if (units[i] == '\n') {
+          position.row++;
+          position.column = 0;
+        } else {
+          position.column += 2;
+        }
+      }
+    }
+    UseText();
+  }
+
+  size_t Length() const { return length; }
+
+  std::string Contents() const {
+    return std::string(data ? data : "", length);
+  }
+
+  // The buffer's contents are used in place, so the caller must keep the
+  // buffer alive and unmodified until the parse is complete.
+  void ReadBuffer(Local<Value> buffer) {
+    data = node::Buffer::Data(buffer);
+    length = node::Buffer::Length(buffer);
+    encoding = TSInputEncodingUTF8;
+  }
+
+ private:
+  void UseText() {
+    data = (const char *)text.data();
+    length = text.size() * 2;
+    encoding = TSInputEncodingUTF16;
+  }
+
+  static const char * Read(void *payload, uint32_t byte, TSPoint position, uint32_t *bytes_read) {
+    TextInput *reader = (TextInput *)payload;
+    if (byte >= reader->length) {
+      *bytes_read = 0;
+      return "";
+    }
+    *bytes_read = reader->length - byte;
+    return reader->data + byte;
+  }
+
+  std::vector<uint16_t> text;
+  const char *data;
+  size_t length;
+  TSInputEncoding encoding;
+};
+
+// Builds the error reported for a halted parse. Its `code` is `ECANCELED`
+// when the cancellation flag stopped it and `ETIMEDOUT` otherwise.
+static Local<Value> halted_parse_error(bool cancelled) {
+  Local<Value> error = Nan::Error(cancelled ? "Parse was cancelled" : "Parse timed out");
+  Nan::Set(
+    Local<Object>::Cast(error),
+    Nan::New("code").ToLocalChecked(),
+    Nan::New(cancelled ? "ECANCELED" : "ETIMEDOUT").ToLocalChecked()
+  );
+  return error;
+}
+
+// Must be checked before the cancellation flag is cleared.
+static bool parse_was_cancelled(TSParser *parser) {
+  const size_t *flag = ts_parser_cancellation_flag(parser);
+  return flag && *flag;
+}
+
+class ParseWorker : public Nan::AsyncWorker {
+ public:
+  ParseWorker(Nan::Callback *callback, AddonData *data, Parser *parser, const TSTree *old_tree, TSInputEncoding encoding)
+    : Nan::AsyncWorker(callback, "tree-sitter:parseAsync"),
+      data(data),
+      parser(parser),
+      old_tree(old_tree ? ts_tree_copy(old_tree) : nullptr),
+      encoding(encoding),
+      result(nullptr) {}
+
+  ~ParseWorker() {
+    if (old_tree) ts_tree_delete(old_tree);
+    if (result) ts_tree_delete(result);
+  }
+
+  TextInput text_input;
+  bool keep_text = false;
+  bool halted = false;
+  bool cancelled = false;
+  ParseStats stats;
+
+  void Execute() {
+    uint64_t wall_start_time = wall_time_now();
+    uint64_t cpu_start_time = cpu_time_now();
+    result = ts_parser_parse(parser->parser_, old_tree, text_input.Input());
+    finish_parse_stats(&stats, old_tree, result, wall_start_time, cpu_start_time);
+    halted = !result && ts_parser_language(parser->parser_);
+    cancelled = halted && parse_was_cancelled(parser->parser_);
+  }
+
+  void HandleOKCallback() {
+    Nan::HandleScope scope;
+    parser->is_parsing_async_ = false;
+    ts_parser_set_cancellation_flag(parser->parser_, nullptr);
+    parser->stats_.Add(stats);
+
+    if (halted) {
+      Local<Value> argv[1] = { halted_parse_error(cancelled) };
+      callback->Call(1, argv, async_resource);
+      return;
+    }
+
+    std::string source_text;
+    if (keep_text) source_text = text_input.Contents();
+    Local<Value> tree = Tree::NewInstance(data, result, encoding, keep_text ? &source_text : nullptr);
+    Tree::SetParseStats(tree, stats);
+    result = nullptr;
+
+    Local<Value> argv[2] = { Nan::Null(), tree };
+    callback->Call(2, argv, async_resource);
+  }
+
+  void HandleErrorCallback() {
+    parser->is_parsing_async_ = false;
+    ts_parser_set_cancellation_flag(parser->parser_, nullptr);
+    Nan::AsyncWorker::HandleErrorCallback();
+  }
+
+ private:
+  AddonData *data;
+  Parser *parser;
+  TSTree *old_tree;
+  TSInputEncoding encoding;
+  TSTree *result;
+};
+
+static bool ensure_parser_is_idle(Parser *parser) {
+  if (parser->is_parsing_async_) {
+    Nan::ThrowError("Parser is busy with an asynchronous parse");
+    return false;
+  }
+  return true;
+}
+
+void Parser::Init(Local<Object> exports, AddonData *data) {
+  Local<External> data_ext = Nan::New<External>(data);
+  Local<FunctionTemplate> tpl = Nan::New<FunctionTemplate>(New, data_ext);
   tpl->InstanceTemplate()->SetInternalFieldCount(1);
   Local<String> class_name = Nan::New("Parser").ToLocalChecked();
   tpl->SetClassName(class_name);
@@ -112,25 +394,34 @@ void Parser::Init(Local<Object> exports) {
   FunctionPair methods[] = {
     {"getLogger", GetLogger},
     {"setLogger", SetLogger},
+    {"_setLogBuffer", SetLogBuffer},
+    {"_drainLog", DrainLog},
     {"setLanguage", SetLanguage},
     {"printDotGraphs", PrintDotGraphs},
+    {"setCountNewNodes", SetCountNewNodes},
     {"parse", Parse},
+    {"parseAsync", ParseAsync},
+    {"_reparse", Reparse},
+    {"stats", Stats},
+    {"reset", Reset},
   };
 
   for (size_t i = 0; i < length_of_array(methods); i++) {
-    Nan::SetPrototypeMethod(tpl, methods[i].name, methods[i].callback);
+    Nan::SetPrototypeMethod(tpl, methods[i].name, methods[i].callback, data_ext);
   }
 
-  constructor.Reset(Nan::Persistent<Function>(Nan::GetFunction(tpl).ToLocalChecked()));
-  Nan::Set(exports, class_name, Nan::New(constructor));
+  Nan::SetMethod(tpl, "parseMany", ParseMany, data_ext);
+
+  data->parser_constructor.Reset(Nan::GetFunction(tpl).ToLocalChecked());
+  Nan::Set(exports, class_name, Nan::New(data->parser_constructor));
   Nan::Set(exports, Nan::New("LANGUAGE_VERSION").ToLocalChecked(), Nan::New<Number>(TREE_SITTER_LANGUAGE_VERSION));
 }
 
-Parser::Parser() : parser_(ts_parser_new()) {}
+Parser::Parser() : parser_(ts_parser_new()), is_parsing_async_(false), count_new_nodes_(false) {}
 
 Parser::~Parser() { ts_parser_delete(parser_); }
 
-static bool handle_included_ranges(TSParser *parser, Local<Value> arg) {
+static bool handle_included_ranges(AddonData *data, TSParser *parser, Local<Value> arg, TSInputEncoding encoding) {
   uint32_t last_included_range_end = 0;
   if (arg->IsArray()) {
     auto js_included_ranges = Local<Array>::Cast(arg);
@@ -138,7 +429,7 @@ static bool handle_included_ranges(TSParser *parser, Local<Value> arg) {
     for (unsigned i = 0; i < js_included_ranges->Length(); i++) {
       Local<Value> range_value;
       if (!Nan::Get(js_included_ranges, i).ToLocal(&range_value)) return false;
-      auto maybe_range = RangeFromJS(range_value);
+      auto maybe_range = RangeFromJS(data, range_value, encoding);
       if (!maybe_range.IsJust()) return false;
       auto range = maybe_range.FromJust();
       if (range.start_byte < last_included_range_end) {
@@ -156,6 +447,83 @@ static bool handle_included_ranges(TSParser *parser, Local<Value> arg) {
   return true;
 }
 
+// The cancellation flag is read by the parser as a `size_t`, so it must be
+// backed by at least that many suitably aligned bytes. It is normally a view
+// on a SharedArrayBuffer, so that other threads can set it.
+static bool handle_parse_limits(TSParser *parser, Local<Value> js_timeout, Local<Value> js_flag) {
+  uint64_t timeout_micros = 0;
+  if (!js_timeout->IsUndefined() && !js_timeout->IsNull()) {
+    double value = Nan::To<double>(js_timeout).FromMaybe(-1);
+    if (!(value >= 0)) {
+      Nan::ThrowTypeError("Timeout must be a non-negative number of microseconds");
+      return false;
+    }
+    timeout_micros = static_cast<uint64_t>(value);
+  }
+
+  const size_t *cancellation_flag = nullptr;
+  if (!js_flag->IsUndefined() && !js_flag->IsNull()) {
+    if (!js_flag->IsArrayBufferView()) {
+      Nan::ThrowTypeError("Cancellation flag must be a typed array");
+      return false;
+    }
+    Nan::TypedArrayContents<size_t> contents(js_flag);
+    if (contents.length() == 0) {
+      Nan::ThrowTypeError("Cancellation flag must span at least one aligned machine word");
+      return false;
+    }
+    cancellation_flag = *contents;
+  }
+
+  ts_parser_set_timeout_micros(parser, timeout_micros);
+  ts_parser_set_cancellation_flag(parser, cancellation_flag);
+  return true;
+}
+
+static bool encoding_from_js(Local<Value> input, Local<Value> js_encoding, TSInputEncoding *encoding) {
+  bool is_buffer = node::Buffer::HasInstance(input);
+  *encoding = is_buffer ? TSInputEncodingUTF8 : TSInputEncodingUTF16;
+  if (js_encoding->IsUndefined() || js_encoding->IsNull()) return true;
+
+  Nan::Utf8String js_encoding_name(js_encoding);
+  std::string encoding_name(*js_encoding_name ? *js_encoding_name : "");
+  if (encoding_name == "utf8" || encoding_name == "utf-8") {
+    if (!is_buffer) {
+      Nan::ThrowTypeError("UTF-8 input must be a Buffer or Uint8Array");
+      return false;
+    }
+  } else if (encoding_name == "utf16" || encoding_name == "utf-16") {
+    if (is_buffer) {
+      Nan::ThrowTypeError("Buffer input must be UTF-8 encoded");
+      return false;
+    }
+  } else {
+    Nan::ThrowTypeError("Encoding must be either 'utf8' or 'utf16'");
+    return false;
+  }
+
+  return true;
+}
+
+static bool old_tree_from_js(AddonData *data, Local<Value> arg, TSInputEncoding encoding, const Tree **result) {
+  *result = nullptr;
+  if (arg->IsNull() || arg->IsUndefined()) return true;
+
+  const Tree *tree = Tree::UnwrapTree(data, arg);
+  if (!tree) {
+    Nan::ThrowTypeError("Second argument must be a tree");
+    return false;
+  }
+
+  if (tree->encoding_ != encoding) {
+    Nan::ThrowTypeError("Old tree must have the same encoding as the input");
+    return false;
+  }
+
+  *result = tree;
+  return true;
+}
+
 void Parser::New(const Nan::FunctionCallbackInfo<Value> &info) {
   if (info.IsConstructCall()) {
     Parser *parser = new Parser();
@@ -163,7 +531,7 @@ void Parser::New(const Nan::FunctionCallbackInfo<Value> &info) {
     info.GetReturnValue().Set(info.This());
   } else {
     Local<Object> self;
-    MaybeLocal<Object> maybe_self = Nan::New(constructor)->NewInstance(Nan::GetCurrentContext());
+    MaybeLocal<Object> maybe_self = Nan::New(GetAddonData(info)->parser_constructor)->NewInstance(Nan::GetCurrentContext());
     if (maybe_self.ToLocal(&self)) {
       info.GetReturnValue().Set(self);
     } else {
@@ -174,6 +542,7 @@ void Parser::New(const Nan::FunctionCallbackInfo<Value> &info) {
 
 void Parser::SetLanguage(const Nan::FunctionCallbackInfo<Value> &info) {
   Parser *parser = ObjectWrap::Unwrap<Parser>(info.This());
+  if (!ensure_parser_is_idle(parser)) return;
 
   const TSLanguage *language = language_methods::UnwrapLanguage(info[0]);
   if (language) {
@@ -182,38 +551,254 @@ void Parser::SetLanguage(const Nan::FunctionCallbackInfo<Value> &info) {
   }
 }
 
+static void start_logged_parse(TSParser *parser) {
+  TSLogger logger = ts_parser_logger(parser);
+  if (logger.payload && logger.log == LogBuffer::Log) {
+    ((LogBuffer *)logger.payload)->StartParse();
+  }
+}
+
+// Parses an input synchronously. When the tree keeps its text, the input is
+// flattened and copied to `source_text`, reading callback inputs up front so
+// that the same text is both parsed and kept.
+static TSTree *parse_input(
+  AddonData *data,
+  TSParser *parser,
+  const TSTree *old_tree,
+  Local<Value> input,
+  Local<Value> buffer_size,
+  std::string *source_text,
+  ParseStats *stats
+) {
+  start_logged_parse(parser);
+  uint64_t wall_start_time = wall_time_now();
+  uint64_t cpu_start_time = cpu_time_now();
+
+  TSTree *tree;
+  if (input->IsFunction() && !source_text) {
+    CallbackInput callback_input(data, Local<Function>::Cast(input), buffer_size);
+    callback_input.stats = stats;
+    tree = ts_parser_parse(parser, old_tree, callback_input.Input());
+  } else {
+    TextInput text_input;
+    if (input->IsString()) {
+      text_input.ReadString(Local<String>::Cast(input));
+      stats->bytes_read += text_input.Length();
+    } else if (input->IsFunction()) {
+      CallbackInput callback_input(data, Local<Function>::Cast(input), buffer_size);
+      callback_input.stats = stats;
+      text_input.ReadCallback(callback_input);
+    } else {
+      text_input.ReadBuffer(input);
+      stats->bytes_read += text_input.Length();
+    }
+    tree = ts_parser_parse(parser, old_tree, text_input.Input());
+    if (source_text) *source_text = text_input.Contents();
+  }
+
+  finish_parse_stats(stats, old_tree, tree, wall_start_time, cpu_start_time);
+  return tree;
+}
+
 void Parser::Parse(const Nan::FunctionCallbackInfo<Value> &info) {
+  AddonData *data = GetAddonData(info);
   Parser *parser = ObjectWrap::Unwrap<Parser>(info.This());
+  if (!ensure_parser_is_idle(parser)) return;
 
-  if (!info[0]->IsFunction()) {
-    Nan::ThrowTypeError("Input must be a function");
+  if (!info[0]->IsString() && !info[0]->IsFunction() && !node::Buffer::HasInstance(info[0])) {
+    Nan::ThrowTypeError("Input must be a string, a Buffer or a function");
     return;
   }
 
-  Local<Function> callback = Local<Function>::Cast(info[0]);
+  TSInputEncoding encoding;
+  if (!encoding_from_js(info[0], info[4], &encoding)) return;
 
-  Local<Object> js_old_tree;
-  const TSTree *old_tree = nullptr;
-  if (info.Length() > 1 && !info[1]->IsNull() && !info[1]->IsUndefined() && Nan::To<Object>(info[1]).ToLocal(&js_old_tree)) {
-    const Tree *tree = Tree::UnwrapTree(js_old_tree);
-    if (!tree) {
-      Nan::ThrowTypeError("Second argument must be a tree");
-      return;
-    }
-    old_tree = tree->tree_;
-  }
+  const Tree *old_tree;
+  if (!old_tree_from_js(data, info[1], encoding, &old_tree)) return;
 
   Local<Value> buffer_size = Nan::Null();
   if (info.Length() > 2) buffer_size = info[2];
 
-  if (!handle_included_ranges(parser->parser_, info[3])) return;
+  if (!handle_included_ranges(data, parser->parser_, info[3], encoding)) return;
+  if (!handle_parse_limits(parser->parser_, info[5], info[6])) return;
+
+  bool keep_text = Nan::To<bool>(info[7]).FromMaybe(false);
+  std::string source_text;
+  ParseStats stats;
+  stats.counts_new_nodes = parser->count_new_nodes_;
+  TSTree *tree = parse_input(
+    data, parser->parser_, old_tree ? old_tree->tree_ : nullptr,
+    info[0], buffer_size, keep_text ? &source_text : nullptr, &stats
+  );
+  bool halted = !tree && ts_parser_language(parser->parser_);
+  bool cancelled = halted && parse_was_cancelled(parser->parser_);
+  ts_parser_set_cancellation_flag(parser->parser_, nullptr);
+  parser->stats_.Add(stats);
+
+  // A parse halted by the timeout or the cancellation flag throws an error
+  // whose `code` tells the two apart. The parser keeps its state, so calling
+  // `parse` again with the same input resumes where it left off. Without a
+  // language there is nothing to parse, and the result is null.
+  if (halted) {
+    Nan::ThrowError(halted_parse_error(cancelled));
+    return;
+  }
+
+  Local<Value> result = Tree::NewInstance(data, tree, encoding, keep_text ? &source_text : nullptr);
+  Tree::SetParseStats(result, stats);
+  info.GetReturnValue().Set(result);
+}
+
+enum {
+  kChangedRangeStartIndex,
+  kChangedRangeEndIndex,
+  kChangedRangeStartRow,
+  kChangedRangeStartColumn,
+  kChangedRangeEndRow,
+  kChangedRangeEndColumn,
+  kChangedRangeStride,
+};
+
+// Edits a tree, parses the new input against it and diffs the two trees in
+// one call. Returns the new tree and the changed ranges, packed into a
+// Uint32Array, or throws like `Parse` if the parse was halted.
+void Parser::Reparse(const Nan::FunctionCallbackInfo<Value> &info) {
+  AddonData *data = GetAddonData(info);
+  Parser *parser = ObjectWrap::Unwrap<Parser>(info.This());
+  if (!ensure_parser_is_idle(parser)) return;
+
+  if (!info[2]->IsString() && !info[2]->IsFunction() && !node::Buffer::HasInstance(info[2])) {
+    Nan::ThrowTypeError("Input must be a string, a Buffer or a function");
+    return;
+  }
+
+  TSInputEncoding encoding;
+  if (!encoding_from_js(info[2], info[5], &encoding)) return;
+
+  const Tree *old_tree;
+  if (!old_tree_from_js(data, info[0], encoding, &old_tree)) return;
+  if (!old_tree) {
+    Nan::ThrowTypeError("Old tree must be a Tree");
+    return;
+  }
+
+  // Every argument is checked before the tree is edited, so that a call that
+  // throws leaves the tree as it was.
+  if (!handle_included_ranges(data, parser->parser_, info[4], encoding)) return;
+  if (!handle_parse_limits(parser->parser_, info[6], info[7])) return;
+
+  Tree *edited_tree = ObjectWrap::Unwrap<Tree>(Local<Object>::Cast(info[0]));
+  if (!edited_tree->ApplyEdits(info[1], Nan::Undefined())) {
+    ts_parser_set_cancellation_flag(parser->parser_, nullptr);
+    return;
+  }
+
+  bool keep_text = Nan::To<bool>(info[8]).FromMaybe(false);
+  std::string source_text;
+  ParseStats stats;
+  stats.counts_new_nodes = parser->count_new_nodes_;
+  TSTree *tree = parse_input(
+    data, parser->parser_, old_tree->tree_,
+    info[2], info[3], keep_text ? &source_text : nullptr, &stats
+  );
+  bool halted = !tree && ts_parser_language(parser->parser_);
+  bool cancelled = halted && parse_was_cancelled(parser->parser_);
+  ts_parser_set_cancellation_flag(parser->parser_, nullptr);
+  parser->stats_.Add(stats);
+  if (halted) {
+    Nan::ThrowError(halted_parse_error(cancelled));
+    return;
+  }
+  if (!tree) {
+    info.GetReturnValue().Set(Nan::Null());
+    return;
+  }
+
+  uint32_t range_count;
+  TSRange *ranges = ts_tree_get_changed_ranges(old_tree->tree_, tree, &range_count);
+  uint32_t bytes_per_character = BytesPerCharacter(encoding);
+  std::vector<uint32_t> packed_ranges(range_count * kChangedRangeStride);
+  for (uint32_t i = 0; i < range_count; i++) {
+    uint32_t *fields = &packed_ranges[i * kChangedRangeStride];
+    fields[kChangedRangeStartIndex] = ranges[i].start_byte / bytes_per_character;
+    fields[kChangedRangeEndIndex] = ranges[i].end_byte / bytes_per_character;
+    fields[kChangedRangeStartRow] = ranges[i].start_point.row;
+    fields[kChangedRangeStartColumn] = ranges[i].start_point.column / bytes_per_character;
+    fields[kChangedRangeEndRow] = ranges[i].end_point.row;
+    fields[kChangedRangeEndColumn] = ranges[i].end_point.column / bytes_per_character;
+  }
+  free(ranges);
 
-  CallbackInput callback_input(callback, buffer_size);
-  TSTree *tree = ts_parser_parse(parser->parser_, old_tree, callback_input.Input());
-  Local<Value> result = Tree::NewInstance(tree);
+  Local<Value> js_tree = Tree::NewInstance(data, tree, encoding, keep_text ? &source_text : nullptr);
+  Tree::SetParseStats(js_tree, stats);
+  Local<Array> result = Nan::New<Array>(2);
+  Nan::Set(result, 0, js_tree);
+  Nan::Set(result, 1, NewUint32Array(packed_ranges.data(), packed_ranges.size()));
   info.GetReturnValue().Set(result);
 }
 
+void Parser::ParseAsync(const Nan::FunctionCallbackInfo<Value> &info) {
+  AddonData *data = GetAddonData(info);
+  Parser *parser = ObjectWrap::Unwrap<Parser>(info.This());
+  if (!ensure_parser_is_idle(parser)) return;
+
+  if (!info[0]->IsString() && !info[0]->IsFunction() && !node::Buffer::HasInstance(info[0])) {
+    Nan::ThrowTypeError("Input must be a string, a Buffer or a function");
+    return;
+  }
+
+  if (!info[7]->IsFunction()) {
+    Nan::ThrowTypeError("Callback must be a function");
+    return;
+  }
+
+  TSInputEncoding encoding;
+  if (!encoding_from_js(info[0], info[4], &encoding)) return;
+
+  const Tree *old_tree;
+  if (!old_tree_from_js(data, info[1], encoding, &old_tree)) return;
+
+  // The logger calls back into JavaScript, which can't happen on the
+  // thread pool.
+  TSLogger current_logger = ts_parser_logger(parser->parser_);
+  if (current_logger.payload && current_logger.log == Logger::Log) {
+    Nan::ThrowError("Cannot parse asynchronously while a logger is set");
+    return;
+  }
+
+  if (!handle_included_ranges(data, parser->parser_, info[3], encoding)) return;
+  if (!handle_parse_limits(parser->parser_, info[5], info[6])) return;
+
+  Nan::Callback *callback = new Nan::Callback(Local<Function>::Cast(info[7]));
+  ParseWorker *worker = new ParseWorker(callback, data, parser, old_tree ? old_tree->tree_ : nullptr, encoding);
+  worker->stats.counts_new_nodes = parser->count_new_nodes_;
+
+  // Strings and callback inputs are copied up front, so that the parse
+  // doesn't need to touch any JavaScript values. Buffers are used in place,
+  // and are kept alive until the parse is complete.
+  if (info[0]->IsString()) {
+    worker->text_input.ReadString(Local<String>::Cast(info[0]));
+    worker->stats.bytes_read += worker->text_input.Length();
+  } else if (info[0]->IsFunction()) {
+    CallbackInput callback_input(data, Local<Function>::Cast(info[0]), info[2]);
+    callback_input.stats = &worker->stats;
+    worker->text_input.ReadCallback(callback_input);
+  } else {
+    worker->text_input.ReadBuffer(info[0]);
+    worker->stats.bytes_read += worker->text_input.Length();
+    worker->SaveToPersistent("input", info[0]);
+  }
+
+  worker->keep_text = Nan::To<bool>(info[8]).FromMaybe(false);
+  worker->SaveToPersistent("parser", info.This());
+  if (old_tree) worker->SaveToPersistent("oldTree", info[1]);
+  if (info[6]->IsArrayBufferView()) worker->SaveToPersistent("cancellationFlag", info[6]);
+
+  start_logged_parse(parser->parser_);
+  parser->is_parsing_async_ = true;
+  Nan::AsyncQueueWorker(worker);
+}
+
 void Parser::GetLogger(const Nan::FunctionCallbackInfo<Value> &info) {
   Parser *parser = ObjectWrap::Unwrap<Parser>(info.This());
 
@@ -228,14 +813,15 @@ void Parser::GetLogger(const Nan::FunctionCallbackInfo<Value> &info) {
 
 void Parser::SetLogger(const Nan::FunctionCallbackInfo<Value> &info) {
   Parser *parser = ObjectWrap::Unwrap<Parser>(info.This());
+  if (!ensure_parser_is_idle(parser)) return;
 
   TSLogger current_logger = ts_parser_logger(parser->parser_);
 
   if (info[0]->IsFunction()) {
-    if (current_logger.payload) delete (Logger *)current_logger.payload;
+    DeleteLogger(current_logger);
     ts_parser_set_logger(parser->parser_, Logger::Make(Local<Function>::Cast(info[0])));
   } else if (!Nan::To<bool>(info[0]).FromMaybe(true)) {
-    if (current_logger.payload) delete (Logger *)current_logger.payload;
+    DeleteLogger(current_logger);
     ts_parser_set_logger(parser->parser_, { 0, 0 });
   } else {
     Nan::ThrowTypeError("Logger callback must either be a function or a falsy value");
@@ -245,8 +831,65 @@ void Parser::SetLogger(const Nan::FunctionCallbackInfo<Value> &info) {
   info.GetReturnValue().Set(info.This());
 }
 
+// Replaces the logger with a ring buffer of the given capacity in bytes,
+// which records the enabled log types for one in every `sampleInterval`
+// parses.
+void Parser::SetLogBuffer(const Nan::FunctionCallbackInfo<Value> &info) {
+  Parser *parser = ObjectWrap::Unwrap<Parser>(info.This());
+  if (!ensure_parser_is_idle(parser)) return;
+
+  auto maybe_capacity = Nan::To<uint32_t>(info[0]);
+  if (maybe_capacity.IsNothing() || maybe_capacity.FromJust() < 16) {
+    Nan::ThrowRangeError("Log buffer capacity must be at least 16 bytes");
+    return;
+  }
+  bool log_parse = Nan::To<bool>(info[1]).FromMaybe(true);
+  bool log_lex = Nan::To<bool>(info[2]).FromMaybe(true);
+  uint32_t sample_interval = Nan::To<uint32_t>(info[3]).FromMaybe(1);
+
+  DeleteLogger(ts_parser_logger(parser->parser_));
+  LogBuffer *log_buffer = new LogBuffer(maybe_capacity.FromJust(), log_parse, log_lex, sample_interval);
+  ts_parser_set_logger(parser->parser_, LogBuffer::Make(log_buffer));
+  info.GetReturnValue().Set(info.This());
+}
+
+// Returns the records in the log buffer, oldest first, and empties it.
+void Parser::DrainLog(const Nan::FunctionCallbackInfo<Value> &info) {
+  Parser *parser = ObjectWrap::Unwrap<Parser>(info.This());
+  if (!ensure_parser_is_idle(parser)) return;
+
+  TSLogger logger = ts_parser_logger(parser->parser_);
+  if (!logger.payload || logger.log != LogBuffer::Log) {
+    info.GetReturnValue().Set(Nan::Null());
+    return;
+  }
+
+  std::vector<char> records = ((LogBuffer *)logger.payload)->Drain();
+  info.GetReturnValue().Set(Nan::CopyBuffer(records.data(), records.size()).ToLocalChecked());
+}
+
+// Returns the totals of the measurements of every parse done by the parser.
+void Parser::Stats(const Nan::FunctionCallbackInfo<Value> &info) {
+  Parser *parser = ObjectWrap::Unwrap<Parser>(info.This());
+  const ParseStats &stats = parser->stats_;
+  Local<Object> result = stats.ToJS();
+  Nan::Set(result, Nan::New("parseCount").ToLocalChecked(), Nan::New<Number>(stats.parse_count));
+  Nan::Set(result, Nan::New("incrementalParseCount").ToLocalChecked(), Nan::New<Number>(stats.incremental_parse_count));
+  Nan::Set(result, Nan::New("newNodeCount").ToLocalChecked(), Nan::New<Number>(stats.new_node_count));
+  info.GetReturnValue().Set(result);
+}
+
+void Parser::Reset(const Nan::FunctionCallbackInfo<Value> &info) {
+  Parser *parser = ObjectWrap::Unwrap<Parser>(info.This());
+  if (!ensure_parser_is_idle(parser)) return;
+
+  ts_parser_reset(parser->parser_);
+  info.GetReturnValue().Set(info.This());
+}
+
 void Parser::PrintDotGraphs(const Nan::FunctionCallbackInfo<Value> &info) {
   Parser *parser = ObjectWrap::Unwrap<Parser>(info.This());
+  if (!ensure_parser_is_idle(parser)) return;
 
   if (Nan::To<bool>(info[0]).FromMaybe(false)) {
     ts_parser_print_dot_graphs(parser->parser_, 2);
@@ -257,4 +900,260 @@ void Parser::PrintDotGraphs(const Nan::FunctionCallbackInfo<Value> &info) {
   info.GetReturnValue().Set(info.This());
 }
 
+// Counting the nodes that an incremental parse didn't reuse walks both trees,
+// so it's only done when it's asked for.
+void Parser::SetCountNewNodes(const Nan::FunctionCallbackInfo<Value> &info) {
+  Parser *parser = ObjectWrap::Unwrap<Parser>(info.This());
+  parser->count_new_nodes_ = Nan::To<bool>(info[0]).FromMaybe(false);
+  info.GetReturnValue().Set(info.This());
+}
+
+// State shared by the workers of a single `parseMany` call. Each worker
+// owns a parser and claims jobs by incrementing `next_job`, so files are
+// spread across the workers as they become free. Finished jobs are queued
+// and handed back to JavaScript, in completion order, on the main thread.
+struct ParseBatch {
+  enum JobStatus { kPending, kInvalid, kParsed, kTimedOut, kIncompatibleLanguage };
+
+  struct Job {
+    TextInput input;
+    const TSLanguage *language = nullptr;
+    TSTree *old_tree = nullptr;
+    TSInputEncoding encoding = TSInputEncodingUTF16;
+    TSTree *result = nullptr;
+    JobStatus status = kPending;
+  };
+
+  ParseBatch(AddonData *data, uint32_t job_count, uint32_t worker_count, uint64_t timeout_micros)
+    : data(data),
+      jobs(job_count),
+      next_job(0),
+      worker_count(worker_count),
+      finished_worker_count(0),
+      timeout_micros(timeout_micros) {}
+
+  ~ParseBatch() {
+    for (Job &job : jobs) {
+      if (job.old_tree) ts_tree_delete(job.old_tree);
+      if (job.result) ts_tree_delete(job.result);
+    }
+    js_jobs.Reset();
+    js_errors.Reset();
+  }
+
+  // Runs on the thread pool.
+  void ParseJobs(TSParser *parser, const Nan::AsyncProgressWorker::ExecutionProgress &progress) {
+    ts_parser_set_timeout_micros(parser, timeout_micros);
+    for (;;) {
+      uint32_t index = next_job++;
+      if (index >= jobs.size()) break;
+
+      Job &job = jobs[index];
+      if (job.status == kPending) {
+        if (
+          ts_parser_language(parser) != job.language &&
+          !ts_parser_set_language(parser, job.language)
+        ) {
+          job.status = kIncompatibleLanguage;
+        } else {
+          job.result = ts_parser_parse(parser, job.old_tree, job.input.Input());
+          if (job.result) {
+            job.status = kParsed;
+          } else {
+            job.status = kTimedOut;
+            ts_parser_reset(parser);
+          }
+        }
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        completed_jobs.push_back(index);
+      }
+      char signal = 0;
+      progress.Send(&signal, 1);
+    }
+  }
+
+  // Runs on the main thread.
+  void DeliverCompletedJobs(Nan::AsyncResource *async_resource) {
+    std::vector<uint32_t> indices;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      indices.swap(completed_jobs);
+    }
+
+    for (uint32_t index : indices) {
+      Nan::HandleScope scope;
+      Job &job = jobs[index];
+      Local<Value> error = Nan::Null();
+      Local<Value> tree = Nan::Null();
+      switch (job.status) {
+        case kParsed:
+          tree = Tree::NewInstance(data, job.result, job.encoding);
+          job.result = nullptr;
+          break;
+        case kTimedOut:
+          error = halted_parse_error(false);
+          break;
+        case kIncompatibleLanguage:
+          error = Nan::Error((
+            "Incompatible language version " + std::to_string(ts_language_version(job.language)) +
+            ". Compatible range: " + std::to_string(TREE_SITTER_MIN_COMPATIBLE_LANGUAGE_VERSION) +
+            " through " + std::to_string(TREE_SITTER_LANGUAGE_VERSION)
+          ).c_str());
+          break;
+        default:
+          error = Nan::Get(Nan::New(js_errors), index).ToLocalChecked();
+          break;
+      }
+
+      Local<Value> argv[3] = { Nan::New(index), error, tree };
+      on_file.Call(3, argv, async_resource);
+    }
+  }
+
+  AddonData *data;
+  std::vector<Job> jobs;
+  std::atomic<uint32_t> next_job;
+  uint32_t worker_count;
+  uint32_t finished_worker_count;
+  uint64_t timeout_micros;
+  std::mutex mutex;
+  std::vector<uint32_t> completed_jobs;
+  Nan::Callback on_file;
+  Nan::Persistent<Object> js_jobs;
+  Nan::Persistent<Object> js_errors;
+};
+
+// Every worker holds the batch's completion callback, but only the last one
+// to finish calls it.
+class ParseManyWorker : public Nan::AsyncProgressWorker {
+ public:
+  ParseManyWorker(Nan::Callback *callback, std::shared_ptr<ParseBatch> batch)
+    : Nan::AsyncProgressWorker(callback, "tree-sitter:parseMany"),
+      batch(batch),
+      parser(ts_parser_new()) {}
+
+  ~ParseManyWorker() {
+    ts_parser_delete(parser);
+  }
+
+  void Execute(const ExecutionProgress &progress) {
+    batch->ParseJobs(parser, progress);
+  }
+
+  void HandleProgressCallback(const char *, size_t) {
+    batch->DeliverCompletedJobs(async_resource);
+  }
+
+  void HandleOKCallback() {
+    Nan::HandleScope scope;
+    batch->DeliverCompletedJobs(async_resource);
+    if (++batch->finished_worker_count == batch->worker_count) {
+      callback->Call(0, nullptr, async_resource);
+    }
+  }
+
+ private:
+  std::shared_ptr<ParseBatch> batch;
+  TSParser *parser;
+};
+
+static bool prepare_parse_job(AddonData *data, ParseBatch::Job *job, Local<Object> js_job) {
+  Local<Value> input, language, old_tree, encoding;
+  if (
+    !Nan::Get(js_job, Nan::New("input").ToLocalChecked()).ToLocal(&input) ||
+    !Nan::Get(js_job, Nan::New("language").ToLocalChecked()).ToLocal(&language) ||
+    !Nan::Get(js_job, Nan::New("oldTree").ToLocalChecked()).ToLocal(&old_tree) ||
+    !Nan::Get(js_job, Nan::New("encoding").ToLocalChecked()).ToLocal(&encoding)
+  ) return false;
+
+  if (!input->IsString() && !input->IsFunction() && !node::Buffer::HasInstance(input)) {
+    Nan::ThrowTypeError("Input must be a string, a Buffer or a function");
+    return false;
+  }
+
+  job->language = language_methods::UnwrapLanguage(language);
+  if (!job->language) return false;
+
+  if (!encoding_from_js(input, encoding, &job->encoding)) return false;
+
+  const Tree *tree;
+  if (!old_tree_from_js(data, old_tree, job->encoding, &tree)) return false;
+  if (tree) job->old_tree = ts_tree_copy(tree->tree_);
+
+  if (input->IsString()) {
+    job->input.ReadString(Local<String>::Cast(input));
+  } else if (input->IsFunction()) {
+    CallbackInput callback_input(data, Local<Function>::Cast(input), Nan::Null());
+    job->input.ReadCallback(callback_input);
+  } else {
+    job->input.ReadBuffer(input);
+  }
+
+  return true;
+}
+
+void Parser::ParseMany(const Nan::FunctionCallbackInfo<Value> &info) {
+  AddonData *data = GetAddonData(info);
+
+  if (!info[0]->IsArray()) {
+    Nan::ThrowTypeError("Jobs must be an array");
+    return;
+  }
+  if (!info[3]->IsFunction() || !info[4]->IsFunction()) {
+    Nan::ThrowTypeError("Callbacks must be functions");
+    return;
+  }
+
+  Local<Array> js_jobs = Local<Array>::Cast(info[0]);
+  uint32_t job_count = js_jobs->Length();
+
+  uint32_t worker_count = Nan::To<uint32_t>(info[1]).FromMaybe(1);
+  if (worker_count > job_count) worker_count = job_count;
+  if (worker_count == 0) worker_count = 1;
+
+  uint64_t timeout_micros = 0;
+  if (info[2]->IsNumber()) {
+    double value = Nan::To<double>(info[2]).FromMaybe(0);
+    if (value > 0) timeout_micros = static_cast<uint64_t>(value);
+  }
+
+  auto batch = std::make_shared<ParseBatch>(data, job_count, worker_count, timeout_micros);
+
+  // Problems with individual jobs are reported through `onFile` instead of
+  // failing the whole batch, so exceptions thrown while reading a job are
+  // caught and kept for later.
+  Local<Array> js_errors = Nan::New<Array>(job_count);
+  for (uint32_t i = 0; i < job_count; i++) {
+    ParseBatch::Job &job = batch->jobs[i];
+    Nan::TryCatch try_catch;
+
+    Local<Value> js_job;
+    bool ok = false;
+    if (Nan::Get(js_jobs, i).ToLocal(&js_job)) {
+      if (js_job->IsObject()) {
+        ok = prepare_parse_job(data, &job, Local<Object>::Cast(js_job));
+      } else {
+        Nan::ThrowTypeError("Job must be an object");
+      }
+    }
+
+    if (!ok) {
+      job.status = ParseBatch::kInvalid;
+      Nan::Set(js_errors, i, try_catch.HasCaught() ? try_catch.Exception() : Nan::Error("Invalid job"));
+    }
+  }
+
+  batch->js_jobs.Reset(js_jobs);
+  batch->js_errors.Reset(js_errors);
+  batch->on_file.Reset(Local<Function>::Cast(info[3]));
+
+  for (uint32_t i = 0; i < worker_count; i++) {
+    Nan::Callback *on_done = new Nan::Callback(Local<Function>::Cast(info[4]));
+    Nan::AsyncQueueWorker(new ParseManyWorker(on_done, batch));
+  }
+}
+
 }  // namespace node_tree_sitter
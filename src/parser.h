@@ -5,14 +5,19 @@
 #include <nan.h>
 #include <node_object_wrap.h>
 #include <tree_sitter/api.h>
+#include "./addon_data.h"
+#include "./tree.h"
 
 namespace node_tree_sitter {
 
 class Parser : public Nan::ObjectWrap {
  public:
-  static void Init(v8::Local<v8::Object> exports);
+  static void Init(v8::Local<v8::Object> exports, AddonData *);
 
   TSParser *parser_;
+  bool is_parsing_async_;
+  ParseStats stats_;
+  bool count_new_nodes_;
 
  private:
   explicit Parser();
@@ -22,10 +27,16 @@ class Parser : public Nan::ObjectWrap {
   static void SetLanguage(const Nan::FunctionCallbackInfo<v8::Value> &);
   static void GetLogger(const Nan::FunctionCallbackInfo<v8::Value> &);
   static void SetLogger(const Nan::FunctionCallbackInfo<v8::Value> &);
+  static void SetLogBuffer(const Nan::FunctionCallbackInfo<v8::Value> &);
+  static void DrainLog(const Nan::FunctionCallbackInfo<v8::Value> &);
   static void Parse(const Nan::FunctionCallbackInfo<v8::Value> &);
+  static void ParseAsync(const Nan::FunctionCallbackInfo<v8::Value> &);
+  static void Reparse(const Nan::FunctionCallbackInfo<v8::Value> &);
+  static void ParseMany(const Nan::FunctionCallbackInfo<v8::Value> &);
+  static void Stats(const Nan::FunctionCallbackInfo<v8::Value> &);
+  static void Reset(const Nan::FunctionCallbackInfo<v8::Value> &);
   static void PrintDotGraphs(const Nan::FunctionCallbackInfo<v8::Value> &);
-
-  static Nan::Persistent<v8::Function> constructor;
+  static void SetCountNewNodes(const Nan::FunctionCallbackInfo<v8::Value> &);
 };
 
 }  // namespace node_tree_sitter
@@ -1,13 +1,17 @@
 #include "./query.h"
+#include <cstring>
 #include <string>
+#include <unordered_set>
 #include <vector>
 #include <v8.h>
 #include <nan.h>
 #include "./node.h"
 #include "./language.h"
 #include "./logger.h"
+#include "./addon_data.h"
 #include "./util.h"
 #include "./conversions.h"
+#include "./query_cursor.h"
 
 namespace node_tree_sitter {
 
@@ -15,6 +19,10 @@ using std::vector;
 using namespace v8;
 using node_methods::UnmarshalNodeId;
 
+// Each capture returned by `_rawCaptures` is a pattern index, a capture id,
+// a start and end index, and the two words of the node's id.
+static const uint32_t RAW_CAPTURE_FIELD_COUNT = 6;
+
 const char *query_error_names[] = {
   "TSQueryErrorNone",
   "TSQueryErrorSyntax",
@@ -24,14 +32,267 @@ const char *query_error_names[] = {
   "TSQueryErrorStructure",
 };
 
-TSQueryCursor *Query::ts_query_cursor;
-Nan::Persistent<Function> Query::constructor;
-Nan::Persistent<FunctionTemplate> Query::constructor_template;
+// Calls `callback` with each code point of `text`, which holds raw bytes in
+// the given encoding. Malformed UTF-8 is decoded as U+FFFD, like Buffer's
+// `toString` does.
+template <typename F>
+static void for_each_code_point(const std::string &text, TSInputEncoding encoding, F callback) {
+  if (encoding == TSInputEncodingUTF16) {
+    size_t length = text.size() / 2;
+    for (size_t i = 0; i < length; i++) {
+      uint16_t unit;
+      memcpy(&unit, &text[i * 2], 2);
+      if (unit >= 0xD800 && unit < 0xDC00 && i + 1 < length) {
+        uint16_t next;
+        memcpy(&next, &text[(i + 1) * 2], 2);
+        if (next >= 0xDC00 && next < 0xE000) {
+          callback(0x10000 + ((unit - 0xD800) << 10) + (next - 0xDC00));
+          i++;
+          continue;
+        }
+      }
+      callback(unit);
+    }
+    return;
+  }
+
+  const uint8_t *bytes = (const uint8_t *)text.data();
+  size_t length = text.size();
+  for (size_t i = 0; i < length;) {
+    uint8_t byte = bytes[i];
+    uint32_t code_point;
+    size_t count;
+    if (byte < 0x80) { code_point = byte; count = 0; }
+    else if ((byte & 0xE0) == 0xC0) { code_point = byte & 0x1F; count = 1; }
+    else if ((byte & 0xF0) == 0xE0) { code_point = byte & 0x0F; count = 2; }
+    else if ((byte & 0xF8) == 0xF0) { code_point = byte & 0x07; count = 3; }
+    else { callback(0xFFFD); i++; continue; }
+
+    size_t j = 1;
+    for (; j <= count && i + j < length && (bytes[i + j] & 0xC0) == 0x80; j++) {
+      code_point = (code_point << 6) | (bytes[i + j] & 0x3F);
+    }
+    callback(j > count ? code_point : 0xFFFD);
+    i += j;
+  }
+}
+
+static std::string utf8_to_utf16(const std::string &text) {
+  std::string result;
+  auto push_unit = [&result](uint16_t unit) {
+    result.append((const char *)&unit, 2);
+  };
+  for_each_code_point(text, TSInputEncodingUTF8, [&push_unit](uint32_t code_point) {
+    if (code_point >= 0x10000) {
+      code_point -= 0x10000;
+      push_unit(0xD800 + (code_point >> 10));
+      push_unit(0xDC00 + (code_point & 0x3FF));
+    } else {
+      push_unit(code_point);
+    }
+  });
+  return result;
+}
+
+// Reads the text of captured nodes from the input that the tree was parsed
+// from: a string, a Buffer, or a function that returns chunks of text. The
+// text is returned as raw bytes in the tree's encoding, so that it can be
+// compared without decoding it.
+class QueryText {
+ public:
+  // Text is read from the tree's own copy of its source when it has one,
+  // and otherwise from the input that it was parsed from.
+  QueryText(Local<Value> input, const Tree *tree) :
+    input(input),
+    encoding(tree->encoding_),
+    source_text(tree->has_source_text_ ? &tree->source_text_ : nullptr),
+    failed(false) {}
+
+  bool IsAvailable() const {
+    return source_text || input->IsString() || input->IsFunction() || node::Buffer::HasInstance(input);
+  }
+
+  bool Read(TSNode node, std::string *text) {
+    uint32_t start = ts_node_start_byte(node);
+    uint32_t end = ts_node_end_byte(node);
+    text->clear();
+    if (end <= start) return true;
+
+    if (source_text) {
+      if (start >= source_text->size()) return true;
+      text->assign(*source_text, start, end - start);
+      return true;
+    }
+
+    if (node::Buffer::HasInstance(input)) {
+      size_t length = node::Buffer::Length(input);
+      if (start >= length) return true;
+      if (end > length) end = length;
+      text->assign(node::Buffer::Data(input) + start, end - start);
+      return true;
+    }
+
+    uint32_t start_unit = start / 2;
+    uint32_t unit_count = (end - start) / 2;
+
+    if (input->IsString()) {
+      Local<String> string = Local<String>::Cast(input);
+      uint32_t length = string->Length();
+      if (start_unit >= length) return true;
+      if (unit_count > length - start_unit) unit_count = length - start_unit;
+      text->resize(unit_count * 2);
+      string->Write(
+
+        // Nan doesn't wrap this functionality
+        #if NODE_MAJOR_VERSION >= 12
+          Isolate::GetCurrent(),
+        #endif
+
+        (uint16_t *)&(*text)[0],
+        start_unit,
+        unit_count,
+        String::NO_NULL_TERMINATION
+      );
+      return true;
+    }
+
+    // Like `getTextFromFunction`, keep asking for chunks until the node's
+    // text has been read.
+    Local<Function> callback = Local<Function>::Cast(input);
+    while (text->size() < unit_count * 2) {
+      Local<Value> argv[1] = {Nan::New<Number>(start_unit + text->size() / 2)};
+      Local<Value> chunk;
+      if (!Nan::Call(callback, GetGlobal(callback), 1, argv).ToLocal(&chunk)) {
+        failed = true;
+        return false;
+      }
+      if (!chunk->IsString()) break;
+      Local<String> string = Local<String>::Cast(chunk);
+      size_t length = string->Length();
+      if (length == 0) break;
+      size_t offset = text->size();
+      text->resize(offset + length * 2);
+      string->Write(
+        #if NODE_MAJOR_VERSION >= 12
+          Isolate::GetCurrent(),
+        #endif
+        (uint16_t *)&(*text)[offset],
+        0,
+        length,
+        String::NO_NULL_TERMINATION
+      );
+    }
+    if (text->size() > unit_count * 2) text->resize(unit_count * 2);
+    return true;
+  }
+
+  Local<Value> input;
+  TSInputEncoding encoding;
+  const std::string *source_text;
+
+  // Set when reading from a function input threw an exception.
+  bool failed;
+};
+
+// Borrows a query cursor from the pool for the duration of a call.
+class PooledQueryCursor {
+ public:
+  explicit PooledQueryCursor(AddonData *data) :
+    data(data), cursor(data->AcquireQueryCursor()) {}
+
+  ~PooledQueryCursor() { data->ReleaseQueryCursor(cursor); }
+
+  AddonData *data;
+  TSQueryCursor *cursor;
+};
+
+// Parses a `#match?` pattern that is a literal string, optionally anchored
+// with `^` and `$`, with metacharacters escaped by backslashes. Other
+// patterns are left to JavaScript's RegExp, so that every pattern is
+// interpreted the same way whichever side evaluates it.
+static bool parse_literal_pattern(const std::string &pattern, TextPredicate *predicate) {
+  static const char *METACHARACTERS = "^$\\.*+?()[]{}|";
+  size_t start = 0, end = pattern.size();
+  predicate->anchored_start = end > start && pattern[start] == '^';
+  if (predicate->anchored_start) start++;
+  predicate->anchored_end = end > start && pattern[end - 1] == '$' &&
+    (end - 1 == start || pattern[end - 2] != '\\');
+  if (predicate->anchored_end) end--;
+
+  std::string literal;
+  for (size_t i = start; i < end; i++) {
+    char c = pattern[i];
+    if (c == '\\') {
+      if (++i == end) return false;
+      c = pattern[i];
+      if (!strchr(METACHARACTERS, c) && c != '/' && c != '-') return false;
+    } else if (strchr(METACHARACTERS, c)) {
+      return false;
+    }
+    literal += c;
+  }
+
+  predicate->utf8_value = literal;
+  predicate->utf16_value = utf8_to_utf16(literal);
+  return true;
+}
+
+// Checks a text against a literal pattern. The text and the literal are in
+// the same encoding, and for UTF-16 a match must start on a code unit.
+static bool matches_literal(const std::string &text, const std::string &literal,
+                            bool anchored_start, bool anchored_end, size_t unit_size) {
+  if (text.size() < literal.size()) return false;
+  if (anchored_start && anchored_end) return text == literal;
+  if (anchored_start) return text.compare(0, literal.size(), literal) == 0;
+  if (anchored_end) return text.compare(text.size() - literal.size(), literal.size(), literal) == 0;
+  for (size_t i = text.find(literal); i != std::string::npos; i = text.find(literal, i + 1)) {
+    if (i % unit_size == 0) return true;
+  }
+  return false;
+}
 
-void Query::Init(Local<Object> exports) {
-  ts_query_cursor = ts_query_cursor_new();
+static bool compile_text_predicate(
+  TSQuery *ts_query,
+  const TSQueryPredicateStep *steps,
+  uint32_t step_count,
+  TextPredicate *predicate
+) {
+  if (step_count != 3) return false;
+  if (steps[0].type != TSQueryPredicateStepTypeString) return false;
+  if (steps[1].type != TSQueryPredicateStepTypeCapture) return false;
+
+  uint32_t length;
+  std::string name(ts_query_string_value_for_id(ts_query, steps[0].value_id, &length), length);
+  predicate->capture_id = steps[1].value_id;
+
+  if (name == "eq?" || name == "not-eq?") {
+    predicate->is_positive = name == "eq?";
+    if (steps[2].type == TSQueryPredicateStepTypeCapture) {
+      predicate->kind = TextPredicate::kEqCapture;
+      predicate->other_capture_id = steps[2].value_id;
+    } else {
+      predicate->kind = TextPredicate::kEqString;
+      const char *value = ts_query_string_value_for_id(ts_query, steps[2].value_id, &length);
+      predicate->utf8_value.assign(value, length);
+      predicate->utf16_value = utf8_to_utf16(predicate->utf8_value);
+    }
+    return true;
+  }
 
-  Local<FunctionTemplate> tpl = Nan::New<FunctionTemplate>(New);
+  if (name == "match?") {
+    if (steps[2].type != TSQueryPredicateStepTypeString) return false;
+    const char *value = ts_query_string_value_for_id(ts_query, steps[2].value_id, &length);
+    predicate->kind = TextPredicate::kMatch;
+    predicate->is_positive = true;
+    return parse_literal_pattern(std::string(value, length), predicate);
+  }
+
+  return false;
+}
+
+void Query::Init(Local<Object> exports, AddonData *data) {
+  Local<External> data_ext = Nan::New<External>(data);
+  Local<FunctionTemplate> tpl = Nan::New<FunctionTemplate>(New, data_ext);
   tpl->InstanceTemplate()->SetInternalFieldCount(1);
   Local<String> class_name = Nan::New("Query").ToLocalChecked();
   tpl->SetClassName(class_name);
@@ -40,29 +301,110 @@ void Query::Init(Local<Object> exports) {
     {"_matches", Matches},
     {"_captures", Captures},
     {"_getPredicates", GetPredicates},
+    {"_iterMatches", IterMatches},
+    {"_rawCaptures", RawCaptures},
+    {"_getCaptureNames", GetCaptureNames},
   };
 
   for (size_t i = 0; i < length_of_array(methods); i++) {
-    Nan::SetPrototypeMethod(tpl, methods[i].name, methods[i].callback);
+    Nan::SetPrototypeMethod(tpl, methods[i].name, methods[i].callback, data_ext);
   }
 
   Local<Function> ctor = Nan::GetFunction(tpl).ToLocalChecked();
 
-  constructor_template.Reset(tpl);
-  constructor.Reset(ctor);
+  data->query_constructor_template.Reset(tpl);
+  data->query_constructor.Reset(ctor);
   Nan::Set(exports, class_name, ctor);
 }
 
-Query::Query(TSQuery *query) : query_(query) {}
+Query::Query(TSQuery *query) : query_(query) {
+  CompileTextPredicates();
+}
 
 Query::~Query() {
   ts_query_delete(query_);
 }
 
-Local<Value> Query::NewInstance(TSQuery *query) {
+void Query::CompileTextPredicates() {
+  uint32_t pattern_count = ts_query_pattern_count(query_);
+  text_predicates_.resize(pattern_count);
+  is_text_predicate_.resize(pattern_count);
+
+  for (uint32_t pattern_index = 0; pattern_index < pattern_count; pattern_index++) {
+    uint32_t step_count;
+    const TSQueryPredicateStep *steps = ts_query_predicates_for_pattern(
+        query_, pattern_index, &step_count);
+
+    for (uint32_t start = 0; start < step_count;) {
+      uint32_t end = start;
+      while (end < step_count && steps[end].type != TSQueryPredicateStepTypeDone) end++;
+
+      TextPredicate predicate;
+      bool is_text_predicate = compile_text_predicate(query_, &steps[start], end - start, &predicate);
+      if (is_text_predicate) text_predicates_[pattern_index].push_back(std::move(predicate));
+      is_text_predicate_[pattern_index].push_back(is_text_predicate);
+      start = end + 1;
+    }
+  }
+}
+
+// Checks the text predicates of a match's pattern. Like the predicates that
+// are evaluated in JavaScript, a predicate whose capture isn't part of the
+// match is considered satisfied.
+bool Query::SatisfiesTextPredicates(const TSQueryMatch &match, QueryText &text) {
+  const vector<TextPredicate> &predicates = text_predicates_[match.pattern_index];
+  if (predicates.empty() || !text.IsAvailable()) return true;
+
+  std::string node_text, other_text;
+  for (const TextPredicate &predicate : predicates) {
+    const TSQueryCapture *capture = nullptr, *other_capture = nullptr;
+    for (uint16_t i = 0; i < match.capture_count; i++) {
+      const TSQueryCapture &c = match.captures[i];
+      if (predicate.kind == TextPredicate::kEqCapture) {
+        if (c.index == predicate.capture_id) capture = &c;
+        if (c.index == predicate.other_capture_id) other_capture = &c;
+      } else if (c.index == predicate.capture_id) {
+        capture = &c;
+        break;
+      }
+    }
+    if (!capture) continue;
+    if (predicate.kind == TextPredicate::kEqCapture && !other_capture) continue;
+
+    if (!text.Read(capture->node, &node_text)) return false;
+
+    bool result;
+    switch (predicate.kind) {
+      case TextPredicate::kEqCapture:
+        if (!text.Read(other_capture->node, &other_text)) return false;
+        result = node_text == other_text;
+        break;
+      case TextPredicate::kEqString:
+        result = node_text == (text.encoding == TSInputEncodingUTF16
+          ? predicate.utf16_value
+          : predicate.utf8_value);
+        break;
+      case TextPredicate::kMatch:
+        if (text.encoding == TSInputEncodingUTF16) {
+          result = matches_literal(node_text, predicate.utf16_value,
+                                   predicate.anchored_start, predicate.anchored_end, 2);
+        } else {
+          result = matches_literal(node_text, predicate.utf8_value,
+                                   predicate.anchored_start, predicate.anchored_end, 1);
+        }
+        break;
+    }
+
+    if (result != predicate.is_positive) return false;
+  }
+
+  return true;
+}
+
+Local<Value> Query::NewInstance(AddonData *data, TSQuery *query) {
   if (query) {
     Local<Object> self;
-    MaybeLocal<Object> maybe_self = Nan::NewInstance(Nan::New(constructor));
+    MaybeLocal<Object> maybe_self = Nan::NewInstance(Nan::New(data->query_constructor));
     if (maybe_self.ToLocal(&self)) {
       (new Query(query))->Wrap(self);
       return self;
@@ -71,17 +413,17 @@ Local<Value> Query::NewInstance(TSQuery *query) {
   return Nan::Null();
 }
 
-Query *Query::UnwrapQuery(const Local<Value> &value) {
+Query *Query::UnwrapQuery(AddonData *data, const Local<Value> &value) {
   if (!value->IsObject()) return nullptr;
   Local<Object> js_query = Local<Object>::Cast(value);
-  if (!Nan::New(constructor_template)->HasInstance(js_query)) return nullptr;
+  if (!Nan::New(data->query_constructor_template)->HasInstance(js_query)) return nullptr;
   return ObjectWrap::Unwrap<Query>(js_query);
 }
 
 void Query::New(const Nan::FunctionCallbackInfo<Value> &info) {
   if (!info.IsConstructCall()) {
     Local<Object> self;
-    MaybeLocal<Object> maybe_self = Nan::New(constructor)->NewInstance(Nan::GetCurrentContext());
+    MaybeLocal<Object> maybe_self = Nan::New(GetAddonData(info)->query_constructor)->NewInstance(Nan::GetCurrentContext());
     if (maybe_self.ToLocal(&self)) {
       info.GetReturnValue().Set(self);
     } else {
@@ -138,13 +480,16 @@ void Query::New(const Nan::FunctionCallbackInfo<Value> &info) {
     Nan::To<Function>(
       Nan::Get(self, Nan::New<String>("_init").ToLocalChecked()).ToLocalChecked()
     ).ToLocalChecked();
-  Nan::Call(init, self, 0, nullptr);
+  Local<Value> argv[1] = { info[0] };
+  Nan::Call(init, self, 1, argv);
 
   info.GetReturnValue().Set(self);
 }
 
+// Returns the predicates that `_init` needs to evaluate in JavaScript: those
+// that weren't compiled into text predicates.
 void Query::GetPredicates(const Nan::FunctionCallbackInfo<Value> &info) {
-  Query *query = Query::UnwrapQuery(info.This());
+  Query *query = Query::UnwrapQuery(GetAddonData(info), info.This());
   auto ts_query = query->query_;
 
   auto pattern_len = ts_query_pattern_count(ts_query);
@@ -160,7 +505,9 @@ void Query::GetPredicates(const Nan::FunctionCallbackInfo<Value> &info) {
 
     if (predicates_len > 0) {
       Local<Array> js_predicate = Nan::New<Array>();
+      const vector<bool> &is_text_predicate = query->is_text_predicate_[pattern_index];
 
+      size_t predicate_index = 0;
       size_t a_index = 0;
       size_t p_index = 0;
       for (size_t i = 0; i < predicates_len; i++) {
@@ -182,7 +529,9 @@ void Query::GetPredicates(const Nan::FunctionCallbackInfo<Value> &info) {
                 ).ToLocalChecked());
             break;
           case TSQueryPredicateStepTypeDone:
-            Nan::Set(js_pattern_predicates, a_index++, js_predicate);
+            if (!is_text_predicate[predicate_index++]) {
+              Nan::Set(js_pattern_predicates, a_index++, js_predicate);
+            }
             js_predicate = Nan::New<Array>();
             p_index = 0;
             break;
@@ -196,13 +545,57 @@ void Query::GetPredicates(const Nan::FunctionCallbackInfo<Value> &info) {
   info.GetReturnValue().Set(js_predicates);
 }
 
+bool Query::ReadMatches(
+  TSQueryCursor *ts_query_cursor,
+  Local<Value> input,
+  const Tree *tree,
+  uint32_t max_matches,
+  Local<Array> js_matches,
+  vector<TSNode> *nodes,
+  bool *is_done
+) {
+  QueryText text(input, tree);
+  uint32_t index = js_matches->Length();
+  uint32_t match_count = 0;
+  TSQueryMatch match;
+
+  *is_done = false;
+  while (match_count < max_matches) {
+    if (!ts_query_cursor_next_match(ts_query_cursor, &match)) {
+      *is_done = true;
+      break;
+    }
+
+    if (!SatisfiesTextPredicates(match, text)) {
+      if (text.failed) return false;
+      continue;
+    }
+
+    match_count++;
+    Nan::Set(js_matches, index++, Nan::New(match.pattern_index));
+
+    for (uint16_t i = 0; i < match.capture_count; i++) {
+      const TSQueryCapture &capture = match.captures[i];
+
+      uint32_t capture_name_len = 0;
+      const char *capture_name = ts_query_capture_name_for_id(
+          query_, capture.index, &capture_name_len);
+
+      TSNode node = capture.node;
+      nodes->push_back(node);
+
+      Local<Value> js_capture = Nan::New(capture_name).ToLocalChecked();
+      Nan::Set(js_matches, index++, js_capture);
+    }
+  }
+
+  return true;
+}
+
 void Query::Matches(const Nan::FunctionCallbackInfo<Value> &info) {
-  Query *query = Query::UnwrapQuery(info.This());
-  const Tree *tree = Tree::UnwrapTree(info[0]);
-  uint32_t start_row    = Nan::To<uint32_t>(info[1]).ToChecked();
-  uint32_t start_column = Nan::To<uint32_t>(info[2]).ToChecked() << 1;
-  uint32_t end_row      = Nan::To<uint32_t>(info[3]).ToChecked();
-  uint32_t end_column   = Nan::To<uint32_t>(info[4]).ToChecked() << 1;
+  AddonData *data = GetAddonData(info);
+  Query *query = Query::UnwrapQuery(data, info.This());
+  const Tree *tree = Tree::UnwrapTree(data, info[0]);
 
   if (query == nullptr) {
     Nan::ThrowError("Missing argument query");
@@ -214,34 +607,26 @@ void Query::Matches(const Nan::FunctionCallbackInfo<Value> &info) {
     return;
   }
 
+  uint32_t bytes_per_character = BytesPerCharacter(tree->encoding_);
+  uint32_t start_row    = Nan::To<uint32_t>(info[1]).ToChecked();
+  uint32_t start_column = Nan::To<uint32_t>(info[2]).ToChecked() * bytes_per_character;
+  uint32_t end_row      = Nan::To<uint32_t>(info[3]).ToChecked();
+  uint32_t end_column   = Nan::To<uint32_t>(info[4]).ToChecked() * bytes_per_character;
+
   TSQuery *ts_query = query->query_;
-  TSNode rootNode = node_methods::UnmarshalNode(tree);
+  TSNode rootNode = node_methods::UnmarshalNode(data, tree);
+  PooledQueryCursor pooled_cursor(data);
+  TSQueryCursor *ts_query_cursor = pooled_cursor.cursor;
   TSPoint start_point = {start_row, start_column};
   TSPoint end_point = {end_row, end_column};
   ts_query_cursor_set_point_range(ts_query_cursor, start_point, end_point);
   ts_query_cursor_exec(ts_query_cursor, ts_query, rootNode);
 
   Local<Array> js_matches = Nan::New<Array>();
-  unsigned index = 0;
   vector<TSNode> nodes;
-  TSQueryMatch match;
-
-  while (ts_query_cursor_next_match(ts_query_cursor, &match)) {
-    Nan::Set(js_matches, index++, Nan::New(match.pattern_index));
-
-    for (uint16_t i = 0; i < match.capture_count; i++) {
-      const TSQueryCapture &capture = match.captures[i];
-
-      uint32_t capture_name_len = 0;
-      const char *capture_name = ts_query_capture_name_for_id(
-          ts_query, capture.index, &capture_name_len);
-
-      TSNode node = capture.node;
-      nodes.push_back(node);
-
-      Local<Value> js_capture = Nan::New(capture_name).ToLocalChecked();
-      Nan::Set(js_matches, index++, js_capture);
-    }
+  bool is_done;
+  if (!query->ReadMatches(ts_query_cursor, info[5], tree, UINT32_MAX, js_matches, &nodes, &is_done)) {
+    return;
   }
 
   auto js_nodes = node_methods::GetMarshalNodes(info, tree, nodes.data(), nodes.size());
@@ -252,13 +637,31 @@ void Query::Matches(const Nan::FunctionCallbackInfo<Value> &info) {
   info.GetReturnValue().Set(result);
 }
 
+bool Query::NextCapture(
+  TSQueryCursor *ts_query_cursor,
+  QueryText &text,
+  std::unordered_set<uint32_t> *satisfied_match_ids,
+  TSQueryMatch *match,
+  uint32_t *capture_index
+) {
+  while (ts_query_cursor_next_capture(ts_query_cursor, match, capture_index)) {
+    // A match is returned once for each of its captures, so remember the
+    // ones that passed, and drop the ones that failed from the cursor.
+    if (satisfied_match_ids->count(match->id)) return true;
+    if (SatisfiesTextPredicates(*match, text)) {
+      satisfied_match_ids->insert(match->id);
+      return true;
+    }
+    if (text.failed) return false;
+    ts_query_cursor_remove_match(ts_query_cursor, match->id);
+  }
+  return false;
+}
+
 void Query::Captures(const Nan::FunctionCallbackInfo<Value> &info) {
-  Query *query = Query::UnwrapQuery(info.This());
-  const Tree *tree = Tree::UnwrapTree(info[0]);
-  uint32_t start_row    = Nan::To<uint32_t>(info[1]).ToChecked();
-  uint32_t start_column = Nan::To<uint32_t>(info[2]).ToChecked() << 1;
-  uint32_t end_row      = Nan::To<uint32_t>(info[3]).ToChecked();
-  uint32_t end_column   = Nan::To<uint32_t>(info[4]).ToChecked() << 1;
+  AddonData *data = GetAddonData(info);
+  Query *query = Query::UnwrapQuery(data, info.This());
+  const Tree *tree = Tree::UnwrapTree(data, info[0]);
 
   if (query == nullptr) {
     Nan::ThrowError("Missing argument query");
@@ -270,25 +673,30 @@ void Query::Captures(const Nan::FunctionCallbackInfo<Value> &info) {
     return;
   }
 
+  uint32_t bytes_per_character = BytesPerCharacter(tree->encoding_);
+  uint32_t start_row    = Nan::To<uint32_t>(info[1]).ToChecked();
+  uint32_t start_column = Nan::To<uint32_t>(info[2]).ToChecked() * bytes_per_character;
+  uint32_t end_row      = Nan::To<uint32_t>(info[3]).ToChecked();
+  uint32_t end_column   = Nan::To<uint32_t>(info[4]).ToChecked() * bytes_per_character;
+
   TSQuery *ts_query = query->query_;
-  TSNode rootNode = node_methods::UnmarshalNode(tree);
+  TSNode rootNode = node_methods::UnmarshalNode(data, tree);
+  PooledQueryCursor pooled_cursor(data);
+  TSQueryCursor *ts_query_cursor = pooled_cursor.cursor;
   TSPoint start_point = {start_row, start_column};
   TSPoint end_point = {end_row, end_column};
   ts_query_cursor_set_point_range(ts_query_cursor, start_point, end_point);
   ts_query_cursor_exec(ts_query_cursor, ts_query, rootNode);
 
+  QueryText text(info[5], tree);
+  std::unordered_set<uint32_t> satisfied_match_ids;
   Local<Array> js_matches = Nan::New<Array>();
   unsigned index = 0;
   vector<TSNode> nodes;
   TSQueryMatch match;
   uint32_t capture_index;
 
-  while (ts_query_cursor_next_capture(
-    ts_query_cursor,
-    &match,
-    &capture_index
-  )) {
-
+  while (query->NextCapture(ts_query_cursor, text, &satisfied_match_ids, &match, &capture_index)) {
     Nan::Set(js_matches, index++, Nan::New(match.pattern_index));
     Nan::Set(js_matches, index++, Nan::New(capture_index));
 
@@ -307,6 +715,8 @@ void Query::Captures(const Nan::FunctionCallbackInfo<Value> &info) {
     }
   }
 
+  if (text.failed) return;
+
   auto js_nodes = node_methods::GetMarshalNodes(info, tree, nodes.data(), nodes.size());
 
   auto result = Nan::New<Array>();
@@ -315,5 +725,99 @@ void Query::Captures(const Nan::FunctionCallbackInfo<Value> &info) {
   info.GetReturnValue().Set(result);
 }
 
+void Query::IterMatches(const Nan::FunctionCallbackInfo<Value> &info) {
+  AddonData *data = GetAddonData(info);
+  Query *query = Query::UnwrapQuery(data, info.This());
+  const Tree *tree = Tree::UnwrapTree(data, info[0]);
+
+  if (query == nullptr) {
+    Nan::ThrowError("Missing argument query");
+    return;
+  }
+
+  if (tree == nullptr) {
+    Nan::ThrowError("Missing argument tree");
+    return;
+  }
+
+  uint32_t start_byte = 0, end_byte = UINT32_MAX, match_limit = UINT32_MAX;
+  if (!info[1]->IsUndefined() && !ByteCountFromJS(info[1], tree->encoding_).To(&start_byte)) return;
+  if (!info[2]->IsUndefined() && !ByteCountFromJS(info[2], tree->encoding_).To(&end_byte)) return;
+  if (!info[3]->IsUndefined() && !Nan::To<uint32_t>(info[3]).To(&match_limit)) return;
+
+  TSNode rootNode = node_methods::UnmarshalNode(data, tree);
+  TSQueryCursor *ts_query_cursor = data->AcquireQueryCursor();
+  ts_query_cursor_set_byte_range(ts_query_cursor, start_byte, end_byte);
+  ts_query_cursor_set_match_limit(ts_query_cursor, match_limit);
+  ts_query_cursor_exec(ts_query_cursor, query->query_, rootNode);
+
+  info.GetReturnValue().Set(QueryCursor::NewInstance(
+    data,
+    ts_query_cursor,
+    info.This(),
+    Local<Object>::Cast(info[0])
+  ));
+}
+
+void Query::RawCaptures(const Nan::FunctionCallbackInfo<Value> &info) {
+  AddonData *data = GetAddonData(info);
+  Query *query = Query::UnwrapQuery(data, info.This());
+  const Tree *tree = Tree::UnwrapTree(data, info[0]);
+
+  if (query == nullptr) {
+    Nan::ThrowError("Missing argument query");
+    return;
+  }
+
+  if (tree == nullptr) {
+    Nan::ThrowError("Missing argument tree");
+    return;
+  }
+
+  uint32_t start_byte = 0, end_byte = UINT32_MAX;
+  if (!info[1]->IsUndefined() && !ByteCountFromJS(info[1], tree->encoding_).To(&start_byte)) return;
+  if (!info[2]->IsUndefined() && !ByteCountFromJS(info[2], tree->encoding_).To(&end_byte)) return;
+
+  TSNode rootNode = node_methods::UnmarshalNode(data, tree);
+  PooledQueryCursor pooled_cursor(data);
+  TSQueryCursor *ts_query_cursor = pooled_cursor.cursor;
+  ts_query_cursor_set_byte_range(ts_query_cursor, start_byte, end_byte);
+  ts_query_cursor_exec(ts_query_cursor, query->query_, rootNode);
+
+  QueryText text(info[3], tree);
+  std::unordered_set<uint32_t> satisfied_match_ids;
+  uint32_t bytes_per_character = BytesPerCharacter(tree->encoding_);
+  vector<uint32_t> records;
+  TSQueryMatch match;
+  uint32_t capture_index;
+
+  while (query->NextCapture(ts_query_cursor, text, &satisfied_match_ids, &match, &capture_index)) {
+    const TSQueryCapture &capture = match.captures[capture_index];
+    uint32_t record[RAW_CAPTURE_FIELD_COUNT] = {
+      match.pattern_index,
+      capture.index,
+      ts_node_start_byte(capture.node) / bytes_per_character,
+      ts_node_end_byte(capture.node) / bytes_per_character,
+    };
+    node_methods::MarshalNodeId(capture.node.id, &record[4]);
+    records.insert(records.end(), record, record + RAW_CAPTURE_FIELD_COUNT);
+  }
+  if (text.failed) return;
+
+  info.GetReturnValue().Set(NewUint32Array(records.data(), records.size()));
+}
+
+void Query::GetCaptureNames(const Nan::FunctionCallbackInfo<Value> &info) {
+  Query *query = Query::UnwrapQuery(GetAddonData(info), info.This());
+  uint32_t capture_count = ts_query_capture_count(query->query_);
+
+  Local<Array> js_names = Nan::New<Array>(capture_count);
+  for (uint32_t i = 0; i < capture_count; i++) {
+    uint32_t length;
+    const char *name = ts_query_capture_name_for_id(query->query_, i, &length);
+    Nan::Set(js_names, i, Nan::New(name, length).ToLocalChecked());
+  }
+  info.GetReturnValue().Set(js_names);
+}
 
 }  // namespace node_tree_sitter
@@ -4,31 +4,68 @@
 #include <v8.h>
 #include <nan.h>
 #include <node_object_wrap.h>
+#include <string>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 #include <tree_sitter/api.h>
+#include "./addon_data.h"
 
 namespace node_tree_sitter {
 
+class QueryText;
+class Tree;
+
+// A `#eq?`, `#not-eq?` or `#match?` predicate, compiled when the query is
+// created so that it can be checked against the source text while iterating
+// over the matches. Only `#match?` patterns that are anchored or unanchored
+// literals are compiled; the others are evaluated in JavaScript.
+struct TextPredicate {
+  enum Kind { kEqCapture, kEqString, kMatch };
+
+  Kind kind;
+  bool is_positive;
+  uint32_t capture_id;
+  uint32_t other_capture_id;
+  std::string utf8_value;
+  std::string utf16_value;
+  bool anchored_start;
+  bool anchored_end;
+};
+
 class Query : public Nan::ObjectWrap {
  public:
-  static void Init(v8::Local<v8::Object> exports);
-  static v8::Local<v8::Value> NewInstance(TSQuery *);
-  static Query *UnwrapQuery(const v8::Local<v8::Value> &);
+  static void Init(v8::Local<v8::Object> exports, AddonData *);
+  static v8::Local<v8::Value> NewInstance(AddonData *, TSQuery *);
+  static Query *UnwrapQuery(AddonData *, const v8::Local<v8::Value> &);
+
+  // Appends up to `max_matches` of the cursor's matches that satisfy their
+  // text predicates to `js_matches` and `nodes`, in the format returned by
+  // `_matches`. Returns false if reading the source text threw.
+  bool ReadMatches(TSQueryCursor *, v8::Local<v8::Value> input, const Tree *,
+                   uint32_t max_matches, v8::Local<v8::Array> js_matches,
+                   std::vector<TSNode> *nodes, bool *is_done);
 
   TSQuery *query_;
+  std::vector<std::vector<TextPredicate>> text_predicates_;
+  std::vector<std::vector<bool>> is_text_predicate_;
 
  private:
   explicit Query(TSQuery *);
   ~Query();
 
+  void CompileTextPredicates();
+  bool SatisfiesTextPredicates(const TSQueryMatch &, QueryText &);
+  bool NextCapture(TSQueryCursor *, QueryText &, std::unordered_set<uint32_t> *satisfied_match_ids,
+                   TSQueryMatch *, uint32_t *capture_index);
+
   static void New(const Nan::FunctionCallbackInfo<v8::Value> &);
   static void Matches(const Nan::FunctionCallbackInfo<v8::Value> &);
   static void Captures(const Nan::FunctionCallbackInfo<v8::Value> &);
   static void GetPredicates(const Nan::FunctionCallbackInfo<v8::Value> &);
-
-  static TSQueryCursor *ts_query_cursor;
-  static Nan::Persistent<v8::Function> constructor;
-  static Nan::Persistent<v8::FunctionTemplate> constructor_template;
+  static void IterMatches(const Nan::FunctionCallbackInfo<v8::Value> &);
+  static void RawCaptures(const Nan::FunctionCallbackInfo<v8::Value> &);
+  static void GetCaptureNames(const Nan::FunctionCallbackInfo<v8::Value> &);
 };
 
 }  // namespace node_tree_sitter
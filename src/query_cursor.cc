@@ -0,0 +1,156 @@
+#include "./query_cursor.h"
+#include <vector>
+#include <v8.h>
+#include <nan.h>
+#include <tree_sitter/api.h>
+#include "./addon_data.h"
+#include "./node.h"
+#include "./query.h"
+#include "./tree.h"
+#include "./util.h"
+
+namespace node_tree_sitter {
+
+using std::vector;
+using namespace v8;
+
+void QueryCursor::Init(Local<Object> exports, AddonData *data) {
+  Local<External> data_ext = Nan::New<External>(data);
+  Local<FunctionTemplate> tpl = Nan::New<FunctionTemplate>(New, data_ext);
+  tpl->InstanceTemplate()->SetInternalFieldCount(1);
+  Local<String> class_name = Nan::New("QueryCursor").ToLocalChecked();
+  tpl->SetClassName(class_name);
+
+  GetterPair getters[] = {
+    {"didExceedMatchLimit", DidExceedMatchLimit},
+  };
+
+  FunctionPair methods[] = {
+    {"_nextMatches", NextMatches},
+  };
+
+  for (size_t i = 0; i < length_of_array(getters); i++) {
+    Nan::SetAccessor(
+      tpl->InstanceTemplate(),
+      Nan::New(getters[i].name).ToLocalChecked(),
+      getters[i].callback,
+      nullptr,
+      data_ext);
+  }
+
+  for (size_t i = 0; i < length_of_array(methods); i++) {
+    Nan::SetPrototypeMethod(tpl, methods[i].name, methods[i].callback, data_ext);
+  }
+
+  Local<Function> ctor = Nan::GetFunction(tpl).ToLocalChecked();
+  data->query_cursor_constructor.Reset(ctor);
+  Nan::Set(exports, class_name, ctor);
+}
+
+Local<Value> QueryCursor::NewInstance(
+  AddonData *data,
+  TSQueryCursor *query_cursor,
+  Local<Object> js_query,
+  Local<Object> js_tree
+) {
+  Local<Object> self;
+  Local<Value> argv[1] = { Nan::New<External>(data) };
+  MaybeLocal<Object> maybe_self = Nan::NewInstance(Nan::New(data->query_cursor_constructor), 1, argv);
+  if (!maybe_self.ToLocal(&self)) {
+    data->ReleaseQueryCursor(query_cursor);
+    return Nan::Null();
+  }
+
+  QueryCursor *cursor = new QueryCursor(data, query_cursor);
+  cursor->edit_generation_ = Tree::UnwrapTree(data, js_tree)->EditGeneration();
+  cursor->Wrap(self);
+  cursor->query_.Reset(js_query);
+  cursor->tree_.Reset(js_tree);
+  return self;
+}
+
+QueryCursor::QueryCursor(AddonData *data, TSQueryCursor *query_cursor)
+  : data_(data), query_cursor_(query_cursor), did_exceed_match_limit_(false), edit_generation_(0) {}
+
+// An abandoned cursor can be collected while its environment is being torn
+// down, so it is deleted here rather than returned to the pool.
+QueryCursor::~QueryCursor() {
+  if (query_cursor_) ts_query_cursor_delete(query_cursor_);
+  query_.Reset();
+  tree_.Reset();
+}
+
+void QueryCursor::Finish() {
+  did_exceed_match_limit_ = ts_query_cursor_did_exceed_match_limit(query_cursor_);
+  data_->ReleaseQueryCursor(query_cursor_);
+  query_cursor_ = nullptr;
+
+  // The query and the tree can now be collected even if the iterator is
+  // still referenced.
+  query_.Reset();
+  tree_.Reset();
+}
+
+// Cursors are only made by `NewInstance`, which passes the addon data as a
+// token that JavaScript can't forge, since a cursor without a TSQueryCursor
+// behind it can't be used.
+void QueryCursor::New(const Nan::FunctionCallbackInfo<Value> &info) {
+  AddonData *data = GetAddonData(info);
+  if (
+    info.Length() != 1 || !info[0]->IsExternal() ||
+    Local<External>::Cast(info[0])->Value() != data
+  ) {
+    Nan::ThrowTypeError("QueryCursor cannot be constructed directly; use query.iterMatches");
+    return;
+  }
+  info.GetReturnValue().Set(info.This());
+}
+
+void QueryCursor::NextMatches(const Nan::FunctionCallbackInfo<Value> &info) {
+  AddonData *data = GetAddonData(info);
+  QueryCursor *cursor = ObjectWrap::Unwrap<QueryCursor>(info.This());
+
+  if (!cursor->query_cursor_) {
+    info.GetReturnValue().Set(Nan::Null());
+    return;
+  }
+
+  uint32_t batch_size = Nan::To<uint32_t>(info[0]).FromMaybe(0);
+  if (batch_size == 0) batch_size = 1;
+
+  Local<Object> js_tree = Nan::New(cursor->tree_);
+  Query *query = Query::UnwrapQuery(data, Nan::New(cursor->query_));
+  const Tree *tree = Tree::UnwrapTree(data, js_tree);
+
+  // The cursor walks the tree as it was when the execution started, so its
+  // remaining matches would be out of date after an edit.
+  if (tree->EditGeneration() != cursor->edit_generation_) {
+    cursor->Finish();
+    Nan::ThrowError("Tree was edited while its matches were being iterated");
+    return;
+  }
+
+  Local<Array> js_matches = Nan::New<Array>();
+  vector<TSNode> nodes;
+  bool is_done;
+  if (!query->ReadMatches(
+    cursor->query_cursor_, info[1], tree, batch_size,
+    js_matches, &nodes, &is_done
+  )) return;
+  if (is_done) cursor->Finish();
+
+  auto js_nodes = node_methods::GetMarshalNodes(info, tree, nodes.data(), nodes.size());
+  auto result = Nan::New<Array>();
+  Nan::Set(result, 0, js_matches);
+  Nan::Set(result, 1, js_nodes);
+  info.GetReturnValue().Set(result);
+}
+
+void QueryCursor::DidExceedMatchLimit(Local<String> property, const Nan::PropertyCallbackInfo<Value> &info) {
+  QueryCursor *cursor = ObjectWrap::Unwrap<QueryCursor>(info.This());
+  info.GetReturnValue().Set(Nan::New(cursor->query_cursor_
+    ? ts_query_cursor_did_exceed_match_limit(cursor->query_cursor_)
+    : cursor->did_exceed_match_limit_));
+}
+
+}  // namespace node_tree_sitter
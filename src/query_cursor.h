@@ -0,0 +1,48 @@
+#ifndef NODE_TREE_SITTER_QUERY_CURSOR_H_
+#define NODE_TREE_SITTER_QUERY_CURSOR_H_
+
+#include <v8.h>
+#include <nan.h>
+#include <node_object_wrap.h>
+#include <tree_sitter/api.h>
+#include "./addon_data.h"
+
+namespace node_tree_sitter {
+
+// An execution of a query that is still in progress. The matches are read
+// from the cursor in batches, so that only the ones that are actually
+// consumed are ever marshalled into JS.
+class QueryCursor : public Nan::ObjectWrap {
+ public:
+  static void Init(v8::Local<v8::Object> exports, AddonData *);
+  static v8::Local<v8::Value> NewInstance(AddonData *, TSQueryCursor *,
+                                          v8::Local<v8::Object> js_query,
+                                          v8::Local<v8::Object> js_tree);
+
+ private:
+  QueryCursor(AddonData *, TSQueryCursor *);
+  ~QueryCursor();
+
+  static void New(const Nan::FunctionCallbackInfo<v8::Value> &);
+  static void NextMatches(const Nan::FunctionCallbackInfo<v8::Value> &);
+  static void DidExceedMatchLimit(v8::Local<v8::String>, const Nan::PropertyCallbackInfo<v8::Value> &);
+
+  void Finish();
+
+  AddonData *data_;
+
+  // Returned to the pool once all of the matches have been read.
+  TSQueryCursor *query_cursor_;
+  bool did_exceed_match_limit_;
+
+  // The edit generation of the tree when the execution started.
+  uint32_t edit_generation_;
+
+  // The query and the tree are kept alive until the cursor is finished.
+  Nan::Persistent<v8::Object> query_;
+  Nan::Persistent<v8::Object> tree_;
+};
+
+}  // namespace node_tree_sitter
+
+#endif  // NODE_TREE_SITTER_QUERY_CURSOR_H_
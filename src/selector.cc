@@ -0,0 +1,271 @@
+#include "./selector.h"
+#include <cctype>
+#include <string>
+#include <vector>
+#include <v8.h>
+#include <nan.h>
+#include "./addon_data.h"
+#include "./language.h"
+#include "./util.h"
+
+namespace node_tree_sitter {
+
+using std::string;
+using std::vector;
+using namespace v8;
+
+// The steps of a selector are tracked as bits of a 64-bit word while it's
+// being matched.
+static const size_t MAX_STEP_COUNT = 64;
+
+static const TSSymbol ERROR_SYMBOL = static_cast<TSSymbol>(-1);
+
+static bool is_name_char(char c) {
+  return isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+// Adds the symbols named `name` to a step's bitset. Like in queries, a bare
+// name refers to named nodes and a quoted one to anonymous nodes, and
+// several symbols can share a name when a grammar uses aliases.
+static bool add_symbols(const TSLanguage *language, const string &name, bool is_named,
+                        vector<uint8_t> *symbols) {
+  auto add = [symbols](TSSymbol symbol) {
+    size_t byte = symbol >> 3;
+    if (symbols->size() <= byte) symbols->resize(byte + 1);
+    (*symbols)[byte] |= 1 << (symbol & 7);
+  };
+
+  if (is_named && name == "ERROR") {
+    add(ERROR_SYMBOL);
+    return true;
+  }
+
+  bool found = false;
+  TSSymbolType wanted_type = is_named ? TSSymbolTypeRegular : TSSymbolTypeAnonymous;
+  for (uint32_t symbol = 0, count = ts_language_symbol_count(language); symbol < count; symbol++) {
+    if (ts_language_symbol_type(language, symbol) != wanted_type) continue;
+    if (name == ts_language_symbol_name(language, symbol)) {
+      add(symbol);
+      found = true;
+    }
+  }
+  return found;
+}
+
+void Selector::Init(Local<Object> exports, AddonData *data) {
+  Local<External> data_ext = Nan::New<External>(data);
+  Local<FunctionTemplate> tpl = Nan::New<FunctionTemplate>(New, data_ext);
+  tpl->InstanceTemplate()->SetInternalFieldCount(1);
+  Local<String> class_name = Nan::New("Selector").ToLocalChecked();
+  tpl->SetClassName(class_name);
+
+  Local<Function> ctor = Nan::GetFunction(tpl).ToLocalChecked();
+
+  data->selector_constructor_template.Reset(tpl);
+  Nan::Set(exports, class_name, ctor);
+}
+
+Selector::Selector(const TSLanguage *language) : language_(language), first_steps_(1) {}
+
+Selector *Selector::UnwrapSelector(AddonData *data, const Local<Value> &value) {
+  if (!value->IsObject()) return nullptr;
+  Local<Object> js_selector = Local<Object>::Cast(value);
+  if (!Nan::New(data->selector_constructor_template)->HasInstance(js_selector)) return nullptr;
+  return ObjectWrap::Unwrap<Selector>(js_selector);
+}
+
+void Selector::New(const Nan::FunctionCallbackInfo<Value> &info) {
+  if (!info.IsConstructCall()) {
+    Nan::ThrowTypeError("Selector must be called with new");
+    return;
+  }
+
+  const TSLanguage *language = language_methods::UnwrapLanguage(info[0]);
+  if (language == nullptr) {
+    Nan::ThrowError("Missing language argument");
+    return;
+  }
+
+  if (!info[1]->IsString()) {
+    Nan::ThrowTypeError("Selector must be a string");
+    return;
+  }
+
+  Nan::Utf8String source(info[1]);
+  Selector *selector = new Selector(language);
+  string error;
+  if (!selector->Compile(string(*source, source.length()), &error)) {
+    delete selector;
+    Nan::ThrowError(error.c_str());
+    return;
+  }
+
+  selector->Wrap(info.This());
+  info.GetReturnValue().Set(info.This());
+}
+
+// Compiles a list of comma-separated selectors. Each selector is a sequence
+// of steps joined by whitespace (any descendant) or `>` (a child), and each
+// step is a node type, `*` for any node or `_` for any named node, followed
+// by any number of `[field=name]` attributes.
+bool Selector::Compile(const string &source, string *error) {
+  size_t i = 0, n = source.size();
+
+  auto fail = [&source, error](const string &message, size_t position) {
+    *error = "Selector error: " + message + " at position " + std::to_string(position) +
+      " of '" + source + "'";
+    return false;
+  };
+
+  auto skip_space = [&]() {
+    size_t start = i;
+    while (i < n && isspace(static_cast<unsigned char>(source[i]))) i++;
+    return i > start;
+  };
+
+  auto read_name = [&]() {
+    size_t start = i;
+    while (i < n && is_name_char(source[i])) i++;
+    return source.substr(start, i - start);
+  };
+
+  skip_space();
+  bool is_child = false;
+  for (;;) {
+    Step step;
+    step.is_wildcard = false;
+    step.named_only = false;
+    step.field_id = 0;
+    step.is_child = is_child;
+    step.is_last = false;
+
+    size_t start = i;
+    if (i < n && source[i] == '*') {
+      step.is_wildcard = true;
+      i++;
+    } else if (i < n && source[i] == '_' && (i + 1 == n || !is_name_char(source[i + 1]))) {
+      step.is_wildcard = true;
+      step.named_only = true;
+      i++;
+    } else if (i < n && source[i] == '"') {
+      size_t end = source.find('"', i + 1);
+      if (end == string::npos) return fail("unterminated string", i);
+      string name = source.substr(i + 1, end - i - 1);
+      if (!add_symbols(language_, name, false, &step.symbols)) {
+        return fail("unknown node type \"" + name + "\"", i);
+      }
+      i = end + 1;
+    } else if (i < n && is_name_char(source[i])) {
+      string name = read_name();
+      if (!add_symbols(language_, name, true, &step.symbols)) {
+        return fail("unknown node type '" + name + "'", start);
+      }
+    } else {
+      step.is_wildcard = true;
+    }
+
+    while (i < n && source[i] == '[') {
+      i++;
+      skip_space();
+      size_t attribute_start = i;
+      if (read_name() != "field") return fail("expected 'field'", attribute_start);
+      skip_space();
+      if (i == n || source[i] != '=') return fail("expected '='", i);
+      i++;
+      skip_space();
+      size_t field_start = i;
+      string field_name = read_name();
+      step.field_id = ts_language_field_id_for_name(language_, field_name.data(), field_name.size());
+      if (!step.field_id) return fail("unknown field '" + field_name + "'", field_start);
+      skip_space();
+      if (i == n || source[i] != ']') return fail("expected ']'", i);
+      i++;
+    }
+
+    if (i == start) return fail("expected a node type", i);
+    if (steps_.size() == MAX_STEP_COUNT) return fail("too many steps", start);
+    steps_.push_back(std::move(step));
+
+    bool has_space = skip_space();
+    if (i == n) {
+      steps_.back().is_last = true;
+      return true;
+    } else if (source[i] == ',') {
+      steps_.back().is_last = true;
+      i++;
+      skip_space();
+      is_child = false;
+      if (steps_.size() < MAX_STEP_COUNT) first_steps_ |= uint64_t(1) << steps_.size();
+    } else if (source[i] == '>') {
+      i++;
+      skip_space();
+      is_child = true;
+    } else if (has_space) {
+      is_child = false;
+    } else {
+      return fail("unexpected character", i);
+    }
+  }
+}
+
+bool Selector::StepMatches(const Step &step, TSNode node, TSFieldId field_id) const {
+  if (step.field_id && step.field_id != field_id) return false;
+  if (step.named_only && !ts_node_is_named(node)) return false;
+  if (step.is_wildcard) return true;
+  TSSymbol symbol = ts_node_symbol(node);
+  size_t byte = symbol >> 3;
+  return byte < step.symbols.size() && (step.symbols[byte] & (1 << (symbol & 7)));
+}
+
+// Advances the match through a node, returning the steps that the nodes
+// below it may match. A step that matched a node lets the next step match
+// either its children or all of its descendants, and the descendant steps
+// of the node's ancestors stay in effect.
+Selector::Frame Selector::Visit(const Frame &parent, TSNode node, TSFieldId field_id, bool *is_match) const {
+  Frame result = {parent.descendant_steps, 0};
+  uint64_t candidates = parent.descendant_steps | parent.child_steps | first_steps_;
+  *is_match = false;
+
+  for (size_t i = 0, n = steps_.size(); i < n; i++) {
+    if (!(candidates & (uint64_t(1) << i))) continue;
+    const Step &step = steps_[i];
+    if (!StepMatches(step, node, field_id)) continue;
+    if (step.is_last) {
+      *is_match = true;
+    } else if (steps_[i + 1].is_child) {
+      result.child_steps |= uint64_t(1) << (i + 1);
+    } else {
+      result.descendant_steps |= uint64_t(1) << (i + 1);
+    }
+  }
+
+  return result;
+}
+
+void Selector::Select(TSTreeCursor *cursor, TSNode node, uint32_t limit, vector<TSNode> *result) const {
+  bool is_match;
+  vector<Frame> frames;
+  ts_tree_cursor_reset(cursor, node);
+  frames.push_back(Visit({0, 0}, node, 0, &is_match));
+
+  for (;;) {
+    if (!ts_tree_cursor_goto_first_child(cursor)) {
+      for (;;) {
+        frames.pop_back();
+        if (frames.empty()) return;
+        if (ts_tree_cursor_goto_next_sibling(cursor)) break;
+        ts_tree_cursor_goto_parent(cursor);
+      }
+    }
+
+    TSNode current = ts_tree_cursor_current_node(cursor);
+    TSFieldId field_id = ts_tree_cursor_current_field_id(cursor);
+    frames.push_back(Visit(frames.back(), current, field_id, &is_match));
+    if (is_match) {
+      result->push_back(current);
+      if (limit && result->size() == limit) return;
+    }
+  }
+}
+
+}  // namespace node_tree_sitter
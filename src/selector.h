@@ -0,0 +1,65 @@
+#ifndef NODE_TREE_SITTER_SELECTOR_H_
+#define NODE_TREE_SITTER_SELECTOR_H_
+
+#include <v8.h>
+#include <nan.h>
+#include <node_object_wrap.h>
+#include <string>
+#include <vector>
+#include <tree_sitter/api.h>
+#include "./addon_data.h"
+
+namespace node_tree_sitter {
+
+// A CSS-like selector over syntax nodes, such as
+// `class_declaration method_definition > identifier[field=name]`, compiled
+// against a language so that it can be matched with a single tree walk.
+class Selector : public Nan::ObjectWrap {
+ public:
+  static void Init(v8::Local<v8::Object> exports, AddonData *);
+  static Selector *UnwrapSelector(AddonData *, const v8::Local<v8::Value> &);
+
+  // Appends the descendants of `node` that match the selector to `result`,
+  // in document order, stopping once there are `limit` of them (if `limit`
+  // isn't zero). The selector is matched within the subtree of `node`, so
+  // ancestors of `node` can't satisfy it.
+  void Select(TSTreeCursor *, TSNode node, uint32_t limit, std::vector<TSNode> *result) const;
+
+  const TSLanguage *language_;
+
+ private:
+  // One compound selector, such as `identifier[field=name]`.
+  struct Step {
+    std::vector<uint8_t> symbols;
+    bool is_wildcard;
+    bool named_only;
+    TSFieldId field_id;
+    // Whether this step must match a child of the node matched by the
+    // previous step (`>`), rather than any descendant.
+    bool is_child;
+    // Whether this step ends one of the comma-separated selectors.
+    bool is_last;
+  };
+
+  // The states of the match that are passed down from a node to the nodes
+  // below it, as bitsets of the steps that may match next.
+  struct Frame {
+    uint64_t descendant_steps;
+    uint64_t child_steps;
+  };
+
+  explicit Selector(const TSLanguage *);
+
+  bool Compile(const std::string &source, std::string *error);
+  bool StepMatches(const Step &, TSNode, TSFieldId) const;
+  Frame Visit(const Frame &parent, TSNode, TSFieldId, bool *is_match) const;
+
+  std::vector<Step> steps_;
+  uint64_t first_steps_;
+
+  static void New(const Nan::FunctionCallbackInfo<v8::Value> &);
+};
+
+}  // namespace node_tree_sitter
+
+#endif  // NODE_TREE_SITTER_SELECTOR_H_
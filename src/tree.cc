@@ -4,45 +4,57 @@
 #include <nan.h>
 #include "./node.h"
 #include "./logger.h"
+#include "./addon_data.h"
 #include "./util.h"
 #include "./conversions.h"
+#include "./flat_tree.h"
 
 namespace node_tree_sitter {
 
 using namespace v8;
 using node_methods::UnmarshalNodeId;
 
-Nan::Persistent<Function> Tree::constructor;
-Nan::Persistent<FunctionTemplate> Tree::constructor_template;
-
-void Tree::Init(Local<Object> exports) {
-  Local<FunctionTemplate> tpl = Nan::New<FunctionTemplate>(New);
+void Tree::Init(Local<Object> exports, AddonData *data) {
+  Local<External> data_ext = Nan::New<External>(data);
+  Local<FunctionTemplate> tpl = Nan::New<FunctionTemplate>(New, data_ext);
   tpl->InstanceTemplate()->SetInternalFieldCount(1);
   Local<String> class_name = Nan::New("Tree").ToLocalChecked();
   tpl->SetClassName(class_name);
 
   FunctionPair methods[] = {
     {"edit", Edit},
+    {"editMany", EditMany},
     {"rootNode", RootNode},
     {"printDotGraph", PrintDotGraph},
     {"getChangedRanges", GetChangedRanges},
     {"getEditedRange", GetEditedRange},
     {"_cacheNode", CacheNode},
     {"_cacheNodes", CacheNodes},
+    {"toFlatArrays", ToFlatArrays},
+    {"_traverse", Traverse},
+    {"getTextRange", GetTextRange},
+    {"_parseStats", GetParseStats},
   };
 
   for (size_t i = 0; i < length_of_array(methods); i++) {
-    Nan::SetPrototypeMethod(tpl, methods[i].name, methods[i].callback);
+    Nan::SetPrototypeMethod(tpl, methods[i].name, methods[i].callback, data_ext);
   }
+  node_methods::InitNodeGetters(tpl);
 
   Local<Function> ctor = Nan::GetFunction(tpl).ToLocalChecked();
 
-  constructor_template.Reset(tpl);
-  constructor.Reset(ctor);
+  data->tree_constructor_template.Reset(tpl);
+  data->tree_constructor.Reset(ctor);
   Nan::Set(exports, class_name, ctor);
 }
 
-Tree::Tree(TSTree *tree) : tree_(tree) {}
+// The number of edits after which the pending edits are applied to every
+// cached node, to keep the edit log from growing without bound.
+static const size_t MAX_PENDING_EDITS = 1024;
+
+Tree::Tree(TSTree *tree, TSInputEncoding encoding)
+  : tree_(tree), encoding_(encoding), first_pending_edit_generation_(0), has_source_text_(false),
+    has_parse_stats_(false), node_count_(-1), traversal_count_(0) {}
 
 Tree::~Tree() {
   ts_tree_delete(tree_);
@@ -51,25 +63,38 @@ Tree::~Tree() {
   }
 }
 
-Local<Value> Tree::NewInstance(TSTree *tree) {
+Local<Value> Tree::NewInstance(AddonData *data, TSTree *tree, TSInputEncoding encoding,
+                               std::string *source_text) {
   if (tree) {
     Local<Object> self;
-    MaybeLocal<Object> maybe_self = Nan::NewInstance(Nan::New(constructor));
+    MaybeLocal<Object> maybe_self = Nan::NewInstance(Nan::New(data->tree_constructor));
     if (maybe_self.ToLocal(&self)) {
-      (new Tree(tree))->Wrap(self);
+      Tree *result = new Tree(tree, encoding);
+      if (source_text) {
+        result->source_text_.swap(*source_text);
+        result->has_source_text_ = true;
+      }
+      result->Wrap(self);
       return self;
     }
   }
   return Nan::Null();
 }
 
-const Tree *Tree::UnwrapTree(const Local<Value> &value) {
+const Tree *Tree::UnwrapTree(AddonData *data, const Local<Value> &value) {
   if (!value->IsObject()) return nullptr;
   Local<Object> js_tree = Local<Object>::Cast(value);
-  if (!Nan::New(constructor_template)->HasInstance(js_tree)) return nullptr;
+  if (!Nan::New(data->tree_constructor_template)->HasInstance(js_tree)) return nullptr;
   return ObjectWrap::Unwrap<Tree>(js_tree);
 }
 
+void Tree::SetParseStats(Local<Value> value, const ParseStats &stats) {
+  if (!value->IsObject()) return;
+  Tree *tree = ObjectWrap::Unwrap<Tree>(Local<Object>::Cast(value));
+  tree->parse_stats_ = stats;
+  tree->has_parse_stats_ = true;
+}
+
 void Tree::New(const Nan::FunctionCallbackInfo<Value> &info) {}
 
 #define read_number_from_js(out, value, name)        \
@@ -82,12 +107,24 @@ void Tree::New(const Nan::FunctionCallbackInfo<Value> &info) {}
 
 #define read_byte_count_from_js(out, value, name)   \
   read_number_from_js(out, value, name);            \
-  (*out) *= 2
+  (*out) *= bytes_per_character
+
+// A traversal keeps a cursor on the tree while it calls back into JS, so the
+// tree can't be edited until the traversal is over.
+bool Tree::CheckNotTraversing() const {
+  if (traversal_count_ > 0) {
+    Nan::ThrowError("Tree can't be edited while it is being traversed");
+    return false;
+  }
+  return true;
+}
 
 void Tree::Edit(const Nan::FunctionCallbackInfo<Value> &info) {
   Tree *tree = ObjectWrap::Unwrap<Tree>(info.This());
+  if (!tree->CheckNotTraversing()) return;
 
   TSInputEdit edit;
+  uint32_t bytes_per_character = BytesPerCharacter(tree->encoding_);
   Nan::Maybe<uint32_t> maybe_number = Nan::Nothing<uint32_t>();
   read_number_from_js(&edit.start_point.row, info[0], "startPosition.row");
   read_byte_count_from_js(&edit.start_point.column, info[1], "startPosition.column");
@@ -99,27 +136,246 @@ void Tree::Edit(const Nan::FunctionCallbackInfo<Value> &info) {
   read_byte_count_from_js(&edit.old_end_byte, info[7], "oldEndIndex");
   read_byte_count_from_js(&edit.new_end_byte, info[8], "newEndIndex");
 
+  // The new text is checked before anything is changed. Without new text,
+  // the kept text can no longer be trusted, and is dropped.
+  std::string new_text;
+  bool keeps_text = tree->has_source_text_ && !info[9]->IsUndefined() && !info[9]->IsNull();
+  if (keeps_text && !tree->ReadEditText(edit, info[9], tree->source_text_.size(), &new_text)) return;
+
   ts_tree_edit(tree->tree_, &edit);
+  if (keeps_text) {
+    tree->source_text_.replace(edit.start_byte, edit.old_end_byte - edit.start_byte, new_text);
+  } else {
+    tree->source_text_.clear();
+    tree->has_source_text_ = false;
+  }
 
-  for (auto &entry : tree->cached_nodes_) {
-    Local<Object> js_node = Nan::New(entry.second->node);
-    TSNode node;
-    node.id = entry.first;
-    for (unsigned i = 0; i < 4; i++) {
-      Local<Value> node_field;
-      if (Nan::Get(js_node, i + 2).ToLocal(&node_field)) {
-        node.context[i] = Nan::To<uint32_t>(node_field).FromMaybe(0);
-      }
+  tree->pending_edits_.push_back(edit);
+  if (tree->pending_edits_.size() >= MAX_PENDING_EDITS) {
+    tree->ApplyPendingEdits();
+  }
+
+  info.GetReturnValue().Set(info.This());
+}
+
+enum {
+  kEditStartIndex,
+  kEditOldEndIndex,
+  kEditNewEndIndex,
+  kEditStartRow,
+  kEditStartColumn,
+  kEditOldEndRow,
+  kEditOldEndColumn,
+  kEditNewEndRow,
+  kEditNewEndColumn,
+  kEditStride,
+};
+
+// Applies a batch of edits packed into an Int32Array or Uint32Array, with the
+// fields of each edit in the order above. Cached nodes are brought up to date
+// lazily, as with `edit`, so this does no per-node work.
+void Tree::EditMany(const Nan::FunctionCallbackInfo<Value> &info) {
+  Tree *tree = ObjectWrap::Unwrap<Tree>(info.This());
+  if (!tree->ApplyEdits(info[0], info[1])) return;
+  info.GetReturnValue().Set(info.This());
+}
+
+bool Tree::ApplyEdits(Local<Value> js_edits, Local<Value> js_new_texts) {
+  if (!CheckNotTraversing()) return false;
+  if (!js_edits->IsInt32Array() && !js_edits->IsUint32Array()) {
+    Nan::ThrowTypeError("Edits must be an Int32Array or Uint32Array");
+    return false;
+  }
+  Nan::TypedArrayContents<int32_t> contents(js_edits);
+  const int32_t *values = *contents;
+  size_t length = contents.length();
+  if (length % kEditStride != 0) {
+    Nan::ThrowRangeError("Edits array length must be a multiple of Tree.EDIT_STRIDE");
+    return false;
+  }
+  for (size_t i = 0; i < length; i++) {
+    if (values[i] < 0) {
+      Nan::ThrowRangeError("Edit fields must be non-negative");
+      return false;
     }
+  }
 
-    ts_node_edit(&node, &edit);
+  size_t edit_count = length / kEditStride;
+  Local<Array> js_texts;
+  if (js_new_texts->IsArray()) {
+    js_texts = Local<Array>::Cast(js_new_texts);
+    if (js_texts->Length() != edit_count) {
+      Nan::ThrowRangeError("There must be one text per edit");
+      return false;
+    }
+  } else if (!js_new_texts->IsUndefined()) {
+    Nan::ThrowTypeError("Texts must be an array");
+    return false;
+  }
 
-    for (unsigned i = 0; i < 4; i++) {
-      Nan::Set(js_node, i + 2, Nan::New(node.context[i]));
+  // Every edit and text is read and checked before any of them is applied,
+  // so that the tree is either edited completely or left as it was.
+  uint32_t bytes_per_character = BytesPerCharacter(encoding_);
+  std::vector<TSInputEdit> edits(edit_count);
+  std::vector<std::string> new_texts(has_source_text_ ? edit_count : 0);
+  bool keeps_text = has_source_text_;
+  size_t text_size = source_text_.size();
+  for (size_t i = 0; i < edit_count; i++) {
+    const int32_t *fields = values + i * kEditStride;
+    TSInputEdit &edit = edits[i];
+    edit.start_byte = fields[kEditStartIndex] * bytes_per_character;
+    edit.old_end_byte = fields[kEditOldEndIndex] * bytes_per_character;
+    edit.new_end_byte = fields[kEditNewEndIndex] * bytes_per_character;
+    edit.start_point = {
+      static_cast<uint32_t>(fields[kEditStartRow]),
+      fields[kEditStartColumn] * bytes_per_character,
+    };
+    edit.old_end_point = {
+      static_cast<uint32_t>(fields[kEditOldEndRow]),
+      fields[kEditOldEndColumn] * bytes_per_character,
+    };
+    edit.new_end_point = {
+      static_cast<uint32_t>(fields[kEditNewEndRow]),
+      fields[kEditNewEndColumn] * bytes_per_character,
+    };
+
+    if (!keeps_text) continue;
+    Local<Value> js_text = Nan::Undefined();
+    if (!js_texts.IsEmpty()) js_text = Nan::Get(js_texts, i).ToLocalChecked();
+    if (js_text->IsUndefined() || js_text->IsNull()) {
+      keeps_text = false;
+      continue;
     }
+    if (!ReadEditText(edit, js_text, text_size, &new_texts[i])) return false;
+    text_size = text_size - (edit.old_end_byte - edit.start_byte) + new_texts[i].size();
   }
 
-  info.GetReturnValue().Set(info.This());
+  pending_edits_.reserve(pending_edits_.size() + edit_count);
+  for (size_t i = 0; i < edit_count; i++) {
+    const TSInputEdit &edit = edits[i];
+    ts_tree_edit(tree_, &edit);
+    pending_edits_.push_back(edit);
+    if (keeps_text) {
+      source_text_.replace(edit.start_byte, edit.old_end_byte - edit.start_byte, new_texts[i]);
+    }
+  }
+  if (has_source_text_ && !keeps_text) {
+    source_text_.clear();
+    has_source_text_ = false;
+  }
+
+  if (pending_edits_.size() >= MAX_PENDING_EDITS) {
+    ApplyPendingEdits();
+  }
+  return true;
+}
+
+// Converts the new text of an edit to the tree's encoding, and checks it
+// against the edit and against the size of the text that the edit applies
+// to. Doesn't change the tree.
+bool Tree::ReadEditText(const TSInputEdit &edit, Local<Value> text, size_t text_size,
+                        std::string *new_text) const {
+  if (node::Buffer::HasInstance(text)) {
+    new_text->assign(node::Buffer::Data(text), node::Buffer::Length(text));
+  } else if (text->IsString()) {
+    Local<String> string = Local<String>::Cast(text);
+    if (encoding_ == TSInputEncodingUTF8) {
+      Nan::Utf8String utf8_string(string);
+      new_text->assign(*utf8_string, utf8_string.length());
+    } else {
+      new_text->resize(string->Length() * 2);
+      string->Write(
+
+        // Nan doesn't wrap this functionality
+        #if NODE_MAJOR_VERSION >= 12
+          Isolate::GetCurrent(),
+        #endif
+
+        (uint16_t *)&(*new_text)[0],
+        0,
+        string->Length(),
+        String::NO_NULL_TERMINATION
+      );
+    }
+  } else {
+    Nan::ThrowTypeError("Edit text must be a string or a Buffer");
+    return false;
+  }
+
+  if (edit.old_end_byte < edit.start_byte || edit.old_end_byte > text_size) {
+    Nan::ThrowRangeError("Edit range is outside of the tree's text");
+    return false;
+  }
+  if (edit.new_end_byte < edit.start_byte || new_text->size() != edit.new_end_byte - edit.start_byte) {
+    Nan::ThrowRangeError("Edit text length doesn't match newEndIndex");
+    return false;
+  }
+  return true;
+}
+
+Local<Value> Tree::SourceTextToJS(uint32_t start_byte, uint32_t end_byte) const {
+  if (!has_source_text_) return Nan::Undefined();
+  if (end_byte > source_text_.size()) end_byte = source_text_.size();
+  if (start_byte > end_byte) start_byte = end_byte;
+
+  const char *text = source_text_.data() + start_byte;
+  uint32_t length = end_byte - start_byte;
+  if (encoding_ == TSInputEncodingUTF8) {
+    return Nan::New<String>(text, length).ToLocalChecked();
+  } else {
+    return Nan::New<String>((const uint16_t *)text, length / 2).ToLocalChecked();
+  }
+}
+
+void Tree::GetTextRange(const Nan::FunctionCallbackInfo<Value> &info) {
+  Tree *tree = ObjectWrap::Unwrap<Tree>(info.This());
+  uint32_t start_byte, end_byte;
+  if (!ByteCountFromJS(info[0], tree->encoding_).To(&start_byte)) return;
+  if (!ByteCountFromJS(info[1], tree->encoding_).To(&end_byte)) return;
+  info.GetReturnValue().Set(tree->SourceTextToJS(start_byte, end_byte));
+}
+
+uint32_t Tree::EditGeneration() const {
+  return first_pending_edit_generation_ + pending_edits_.size();
+}
+
+TSNode Tree::EditNode(TSNode node, uint32_t generation) const {
+  if (generation < first_pending_edit_generation_) {
+    generation = first_pending_edit_generation_;
+  }
+  for (size_t i = generation - first_pending_edit_generation_; i < pending_edits_.size(); i++) {
+    ts_node_edit(&node, &pending_edits_[i]);
+  }
+  return node;
+}
+
+TSNode Tree::CatchUpNode(TSNode node, uint32_t generation) const {
+  node = EditNode(node, generation);
+
+  const auto &cache_entry = cached_nodes_.find(node.id);
+  if (cache_entry != cached_nodes_.end()) {
+    node_methods::SetNodeContext(Nan::New(cache_entry->second->node), node, EditGeneration());
+  }
+  return node;
+}
+
+void Tree::ApplyPendingEdits() {
+  for (auto &entry : cached_nodes_) {
+    Local<Object> js_node = Nan::New(entry.second->node);
+    TSNode node;
+    uint32_t generation;
+    node.id = entry.first;
+    node.tree = tree_;
+    if (
+      node_methods::GetNodeContext(js_node, &node, &generation) &&
+      generation != EditGeneration()
+    ) {
+      CatchUpNode(node, generation);
+    }
+  }
+
+  first_pending_edit_generation_ += pending_edits_.size();
+  pending_edits_.clear();
 }
 
 void Tree::RootNode(const Nan::FunctionCallbackInfo<Value> &info) {
@@ -129,7 +385,8 @@ void Tree::RootNode(const Nan::FunctionCallbackInfo<Value> &info) {
 
 void Tree::GetChangedRanges(const Nan::FunctionCallbackInfo<Value> &info) {
   const Tree *tree = ObjectWrap::Unwrap<Tree>(info.This());
-  const Tree *other_tree = UnwrapTree(info[0]);
+  AddonData *data = GetAddonData(info);
+  const Tree *other_tree = UnwrapTree(data, info[0]);
   if (!other_tree) {
     Nan::ThrowTypeError("Argument must be a tree");
     return;
@@ -140,7 +397,7 @@ void Tree::GetChangedRanges(const Nan::FunctionCallbackInfo<Value> &info) {
 
   Local<Array> result = Nan::New<Array>();
   for (size_t i = 0; i < range_count; i++) {
-    Nan::Set(result, i, RangeToJS(ranges[i]));
+    Nan::Set(result, i, RangeToJS(data, ranges[i], tree->encoding_));
   }
 
   free(ranges);
@@ -193,7 +450,7 @@ void Tree::GetEditedRange(const Nan::FunctionCallbackInfo<Value> &info) {
   }
 
   ts_tree_cursor_delete(&cursor);
-  info.GetReturnValue().Set(RangeToJS(result));
+  info.GetReturnValue().Set(RangeToJS(GetAddonData(info), result, tree->encoding_));
 }
 
 void Tree::PrintDotGraph(const Nan::FunctionCallbackInfo<Value> &info) {
@@ -252,4 +509,162 @@ void Tree::CacheNodes(const Nan::FunctionCallbackInfo<Value> &info) {
   }
 }
 
+// Exports every node of the tree in pre-order as a set of Uint32Array
+// columns that share one ArrayBuffer, so that a whole-tree scan doesn't
+// need to cross into native code once per node.
+void Tree::ToFlatArrays(const Nan::FunctionCallbackInfo<Value> &info) {
+  Tree *tree = ObjectWrap::Unwrap<Tree>(info.This());
+  TSNode root = ts_tree_root_node(tree->tree_);
+  uint32_t node_count = flat_tree::CountNodes(root);
+
+  size_t column_length = node_count;
+  Local<ArrayBuffer> buffer = ArrayBuffer::New(
+    info.GetIsolate(),
+    column_length * flat_tree::kColumnCount * sizeof(uint32_t)
+  );
+  Local<Uint32Array> all_columns = Uint32Array::New(buffer, 0, column_length * flat_tree::kColumnCount);
+  Nan::TypedArrayContents<uint32_t> contents(all_columns);
+  flat_tree::FlattenTree(root, tree->encoding_, node_count, *contents);
+
+  Local<Object> result = Nan::New<Object>();
+  Nan::Set(result, Nan::New("length").ToLocalChecked(), Nan::New(node_count));
+  for (unsigned i = 0; i < flat_tree::kColumnCount; i++) {
+    Nan::Set(
+      result,
+      Nan::New(flat_tree::column_names[i]).ToLocalChecked(),
+      Uint32Array::New(buffer, i * column_length * sizeof(uint32_t), column_length)
+    );
+  }
+  info.GetReturnValue().Set(result);
+}
+
+enum TraversalEvent {
+  kEnterNode,
+  kLeaveNode,
+};
+
+// Walks the tree in C++ and reports the nodes that pass the filters to JS in
+// batches, as a Uint32Array of (event, depth) pairs and an array of nodes.
+void Tree::Traverse(const Nan::FunctionCallbackInfo<Value> &info) {
+  Tree *tree = ObjectWrap::Unwrap<Tree>(info.This());
+
+  NodeTypeFilter filter(info[0], Nan::To<bool>(info[1]).FromMaybe(false));
+  uint32_t max_depth = Nan::To<uint32_t>(info[2]).FromMaybe(UINT32_MAX);
+  bool report_leave = Nan::To<bool>(info[3]).FromMaybe(false);
+  uint32_t batch_size = Nan::To<uint32_t>(info[4]).FromMaybe(0);
+  if (batch_size == 0) batch_size = 1;
+  if (!info[5]->IsFunction()) {
+    Nan::ThrowTypeError("Callback must be a function");
+    return;
+  }
+  Local<Function> callback = Local<Function>::Cast(info[5]);
+
+  std::vector<TSNode> nodes;
+  std::vector<uint32_t> events;
+  auto report = [&](TraversalEvent event, uint32_t depth, TSNode node) {
+    events.push_back(event);
+    events.push_back(depth);
+    nodes.push_back(node);
+  };
+  auto flush = [&]() {
+    if (nodes.empty()) return true;
+    Local<Value> argv[2] = {
+      NewUint32Array(events.data(), events.size()),
+      node_methods::GetMarshalNodes(info, tree, nodes.data(), nodes.size()),
+    };
+    nodes.clear();
+    events.clear();
+    return !Nan::Call(callback, Nan::GetCurrentContext()->Global(), 2, argv).IsEmpty();
+  };
+
+  tree->traversal_count_++;
+  TSTreeCursor cursor = ts_tree_cursor_new(ts_tree_root_node(tree->tree_));
+  std::vector<bool> ancestors_reported;
+  uint32_t depth = 0;
+  bool ok = true;
+  bool done = false;
+  while (!done) {
+    TSNode node = ts_tree_cursor_current_node(&cursor);
+    bool reported = filter.Matches(node);
+    if (reported) report(kEnterNode, depth, node);
+
+    if (depth < max_depth && ts_tree_cursor_goto_first_child(&cursor)) {
+      ancestors_reported.push_back(reported);
+      depth++;
+    } else {
+      if (reported && report_leave) report(kLeaveNode, depth, node);
+      while (!ts_tree_cursor_goto_next_sibling(&cursor)) {
+        if (!ts_tree_cursor_goto_parent(&cursor)) {
+          done = true;
+          break;
+        }
+        depth--;
+        bool parent_reported = ancestors_reported.back();
+        ancestors_reported.pop_back();
+        if (parent_reported && report_leave) {
+          report(kLeaveNode, depth, ts_tree_cursor_current_node(&cursor));
+        }
+      }
+    }
+
+    if (nodes.size() >= batch_size && !(ok = flush())) break;
+  }
+
+  ts_tree_cursor_delete(&cursor);
+  if (ok) flush();
+  tree->traversal_count_--;
+}
+
+void ParseStats::Add(const ParseStats &other) {
+  parse_count += other.parse_count;
+  incremental_parse_count += other.incremental_parse_count;
+  wall_time += other.wall_time;
+  cpu_time += other.cpu_time;
+  callback_time += other.callback_time;
+  bytes_read += other.bytes_read;
+  read_count += other.read_count;
+  new_node_count += other.new_node_count;
+}
+
+// Returns the measurements that are common to trees and parsers, with times
+// in microseconds.
+Local<Object> ParseStats::ToJS() const {
+  Local<Object> result = Nan::New<Object>();
+  Nan::Set(result, Nan::New("wallTime").ToLocalChecked(), Nan::New<Number>(wall_time / 1e3));
+  Nan::Set(result, Nan::New("cpuTime").ToLocalChecked(), Nan::New<Number>(cpu_time / 1e3));
+  Nan::Set(result, Nan::New("callbackTime").ToLocalChecked(), Nan::New<Number>(callback_time / 1e3));
+  Nan::Set(result, Nan::New("bytesRead").ToLocalChecked(), Nan::New<Number>(bytes_read));
+  Nan::Set(result, Nan::New("readCount").ToLocalChecked(), Nan::New<Number>(read_count));
+  return result;
+}
+
+// Returns the stats of the parse that produced the tree, with the node
+// count, which is only computed the first time that it's asked for.
+void Tree::GetParseStats(const Nan::FunctionCallbackInfo<Value> &info) {
+  Tree *tree = ObjectWrap::Unwrap<Tree>(info.This());
+  if (!tree->has_parse_stats_) {
+    info.GetReturnValue().Set(Nan::Null());
+    return;
+  }
+
+  if (tree->node_count_ < 0) {
+    tree->node_count_ = flat_tree::CountNodes(ts_tree_root_node(tree->tree_));
+  }
+
+  const ParseStats &stats = tree->parse_stats_;
+  bool is_incremental = stats.incremental_parse_count > 0;
+  Local<Object> result = stats.ToJS();
+  Nan::Set(result, Nan::New("incremental").ToLocalChecked(), Nan::New(is_incremental));
+  Nan::Set(result, Nan::New("nodeCount").ToLocalChecked(), Nan::New<Number>(tree->node_count_));
+  if (is_incremental && !stats.counts_new_nodes) {
+    Nan::Set(result, Nan::New("newNodeCount").ToLocalChecked(), Nan::Null());
+    Nan::Set(result, Nan::New("reusedNodeCount").ToLocalChecked(), Nan::Null());
+  } else {
+    uint64_t new_node_count = is_incremental ? stats.new_node_count : tree->node_count_;
+    Nan::Set(result, Nan::New("newNodeCount").ToLocalChecked(), Nan::New<Number>(new_node_count));
+    Nan::Set(result, Nan::New("reusedNodeCount").ToLocalChecked(), Nan::New<Number>(tree->node_count_ - new_node_count));
+  }
+  info.GetReturnValue().Set(result);
+}
+
 }  // namespace node_tree_sitter
@@ -4,16 +4,41 @@
 #include <v8.h>
 #include <nan.h>
 #include <node_object_wrap.h>
+#include <string>
 #include <unordered_map>
+#include <vector>
 #include <tree_sitter/api.h>
+#include "./addon_data.h"
 
 namespace node_tree_sitter {
 
+// Measurements of a parse. Each tree records the parse that produced it, and
+// each parser keeps running totals. Times are in nanoseconds.
+struct ParseStats {
+  uint32_t parse_count = 0;
+  uint32_t incremental_parse_count = 0;
+  uint64_t wall_time = 0;
+  uint64_t cpu_time = 0;
+  uint64_t callback_time = 0;
+  uint64_t bytes_read = 0;
+  uint64_t read_count = 0;
+
+  // The number of nodes that weren't reused from the old tree, for
+  // incremental parses. It's only counted when `counts_new_nodes` is set.
+  uint64_t new_node_count = 0;
+  bool counts_new_nodes = false;
+
+  void Add(const ParseStats &);
+  v8::Local<v8::Object> ToJS() const;
+};
+
 class Tree : public Nan::ObjectWrap {
  public:
-  static void Init(v8::Local<v8::Object> exports);
-  static v8::Local<v8::Value> NewInstance(TSTree *);
-  static const Tree *UnwrapTree(const v8::Local<v8::Value> &);
+  static void Init(v8::Local<v8::Object> exports, AddonData *);
+  static v8::Local<v8::Value> NewInstance(AddonData *, TSTree *, TSInputEncoding,
+                                         std::string *source_text = nullptr);
+  static const Tree *UnwrapTree(AddonData *, const v8::Local<v8::Value> &);
+  static void SetParseStats(v8::Local<v8::Value> tree, const ParseStats &);
 
   struct NodeCacheEntry {
     Tree *tree;
@@ -21,24 +46,64 @@ class Tree : public Nan::ObjectWrap {
     v8::Persistent<v8::Object> node;
   };
 
+  // Edits are applied to the tree right away, but the nodes that JS holds
+  // only catch up on them when they are next unmarshalled. Each node records
+  // the edit generation that it is up to date with.
+  uint32_t EditGeneration() const;
+  TSNode CatchUpNode(TSNode, uint32_t generation) const;
+  // Like CatchUpNode, but without updating the node's wrapper object, so
+  // that it doesn't touch the JS heap.
+  TSNode EditNode(TSNode, uint32_t generation) const;
+
+  // Applies edits packed as for `editMany`, along with their new text if
+  // given. Returns false if an exception was thrown.
+  bool ApplyEdits(v8::Local<v8::Value> edits, v8::Local<v8::Value> new_texts);
+
+  // Returns the source text between two byte offsets as a JS string, or
+  // undefined if the tree doesn't keep its source text.
+  v8::Local<v8::Value> SourceTextToJS(uint32_t start_byte, uint32_t end_byte) const;
+
   TSTree *tree_;
+  TSInputEncoding encoding_;
   std::unordered_map<const void *, NodeCacheEntry *> cached_nodes_;
+  std::vector<TSInputEdit> pending_edits_;
+  uint32_t first_pending_edit_generation_;
+
+  // A copy of the source text, in the tree's encoding, kept when the tree
+  // was parsed with `keepText` and spliced by edits that supply new text.
+  std::string source_text_;
+  bool has_source_text_;
+
+  ParseStats parse_stats_;
+  bool has_parse_stats_;
+  int64_t node_count_;
+
+  // The number of traversals of the tree that are in progress. Traversals
+  // can be nested, through the callbacks.
+  uint32_t traversal_count_;
 
  private:
-  explicit Tree(TSTree *);
+  Tree(TSTree *, TSInputEncoding);
   ~Tree();
 
+  void ApplyPendingEdits();
+  bool CheckNotTraversing() const;
+  bool ReadEditText(const TSInputEdit &, v8::Local<v8::Value> text, size_t text_size,
+                    std::string *new_text) const;
+
   static void New(const Nan::FunctionCallbackInfo<v8::Value> &);
   static void Edit(const Nan::FunctionCallbackInfo<v8::Value> &);
+  static void EditMany(const Nan::FunctionCallbackInfo<v8::Value> &);
   static void RootNode(const Nan::FunctionCallbackInfo<v8::Value> &);
   static void PrintDotGraph(const Nan::FunctionCallbackInfo<v8::Value> &);
   static void GetEditedRange(const Nan::FunctionCallbackInfo<v8::Value> &);
   static void GetChangedRanges(const Nan::FunctionCallbackInfo<v8::Value> &);
   static void CacheNode(const Nan::FunctionCallbackInfo<v8::Value> &);
   static void CacheNodes(const Nan::FunctionCallbackInfo<v8::Value> &);
-
-  static Nan::Persistent<v8::Function> constructor;
-  static Nan::Persistent<v8::FunctionTemplate> constructor_template;
+  static void ToFlatArrays(const Nan::FunctionCallbackInfo<v8::Value> &);
+  static void Traverse(const Nan::FunctionCallbackInfo<v8::Value> &);
+  static void GetTextRange(const Nan::FunctionCallbackInfo<v8::Value> &);
+  static void GetParseStats(const Nan::FunctionCallbackInfo<v8::Value> &);
 };
 
 }  // namespace node_tree_sitter
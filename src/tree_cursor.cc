@@ -1,9 +1,13 @@
 #include "./tree_cursor.h"
 #include <nan.h>
+#include <utility>
+#include <vector>
 #include <tree_sitter/api.h>
 #include <v8.h>
+#include "./addon_data.h"
 #include "./util.h"
 #include "./conversions.h"
+#include "./language.h"
 #include "./node.h"
 #include "./tree.h"
 
@@ -11,10 +15,9 @@ namespace node_tree_sitter {
 
 using namespace v8;
 
-Nan::Persistent<Function> TreeCursor::constructor;
-
-void TreeCursor::Init(v8::Local<v8::Object> exports) {
-  Local<FunctionTemplate> tpl = Nan::New<FunctionTemplate>(New);
+void TreeCursor::Init(v8::Local<v8::Object> exports, AddonData *data) {
+  Local<External> data_ext = Nan::New<External>(data);
+  Local<FunctionTemplate> tpl = Nan::New<FunctionTemplate>(New, data_ext);
   Local<String> class_name = Nan::New("TreeCursor").ToLocalChecked();
   tpl->SetClassName(class_name);
   tpl->InstanceTemplate()->SetInternalFieldCount(1);
@@ -26,6 +29,7 @@ void TreeCursor::Init(v8::Local<v8::Object> exports) {
     {"nodeIsNamed", NodeIsNamed},
     {"nodeIsMissing", NodeIsMissing},
     {"currentFieldName", CurrentFieldName},
+    {"descendantIndex", DescendantIndex},
   };
 
   FunctionPair methods[] = {
@@ -37,36 +41,44 @@ void TreeCursor::Init(v8::Local<v8::Object> exports) {
     {"gotoNextSibling", GotoNextSibling},
     {"currentNode", CurrentNode},
     {"reset", Reset},
+    {"gotoLastChild", GotoLastChild},
+    {"gotoPreviousSibling", GotoPreviousSibling},
+    {"gotoDescendant", GotoDescendant},
+    {"resetTo", ResetTo},
+    {"_collect", Collect},
   };
 
   for (size_t i = 0; i < length_of_array(getters); i++) {
     Nan::SetAccessor(
       tpl->InstanceTemplate(),
       Nan::New(getters[i].name).ToLocalChecked(),
-      getters[i].callback);
+      getters[i].callback,
+      nullptr,
+      data_ext);
   }
 
   for (size_t i = 0; i < length_of_array(methods); i++) {
-    Nan::SetPrototypeMethod(tpl, methods[i].name, methods[i].callback);
+    Nan::SetPrototypeMethod(tpl, methods[i].name, methods[i].callback, data_ext);
   }
 
   Local<Function> constructor_local = Nan::GetFunction(tpl).ToLocalChecked();
   Nan::Set(exports, class_name, constructor_local);
-  constructor.Reset(Nan::Persistent<Function>(constructor_local));
+  data->tree_cursor_constructor.Reset(constructor_local);
 }
 
-Local<Value> TreeCursor::NewInstance(TSTreeCursor cursor) {
+Local<Value> TreeCursor::NewInstance(AddonData *data, TSTreeCursor cursor, TSInputEncoding encoding) {
   Local<Object> self;
-  MaybeLocal<Object> maybe_self = Nan::New(constructor)->NewInstance(Nan::GetCurrentContext());
+  MaybeLocal<Object> maybe_self = Nan::New(data->tree_cursor_constructor)->NewInstance(Nan::GetCurrentContext());
   if (maybe_self.ToLocal(&self)) {
-    (new TreeCursor(cursor))->Wrap(self);
+    (new TreeCursor(cursor, encoding))->Wrap(self);
     return self;
   } else {
     return Nan::Null();
   }
 }
 
-TreeCursor::TreeCursor(TSTreeCursor cursor) : cursor_(cursor) {}
+TreeCursor::TreeCursor(TSTreeCursor cursor, TSInputEncoding encoding)
+  : cursor_(cursor), root_(ts_tree_cursor_current_node(&cursor)), encoding_(encoding), exhausted_(false) {}
 
 TreeCursor::~TreeCursor() { ts_tree_cursor_delete(&cursor_); }
 
@@ -77,12 +89,14 @@ void TreeCursor::New(const Nan::FunctionCallbackInfo<Value> &info) {
 void TreeCursor::GotoParent(const Nan::FunctionCallbackInfo<Value> &info) {
   TreeCursor *cursor = Nan::ObjectWrap::Unwrap<TreeCursor>(info.This());
   bool result = ts_tree_cursor_goto_parent(&cursor->cursor_);
+  if (result) cursor->exhausted_ = false;
   info.GetReturnValue().Set(Nan::New(result));
 }
 
 void TreeCursor::GotoFirstChild(const Nan::FunctionCallbackInfo<Value> &info) {
   TreeCursor *cursor = Nan::ObjectWrap::Unwrap<TreeCursor>(info.This());
   bool result = ts_tree_cursor_goto_first_child(&cursor->cursor_);
+  if (result) cursor->exhausted_ = false;
   info.GetReturnValue().Set(Nan::New(result));
 }
 
@@ -93,8 +107,9 @@ void TreeCursor::GotoFirstChildForIndex(const Nan::FunctionCallbackInfo<Value> &
     Nan::ThrowTypeError("Argument must be an integer");
     return;
   }
-  uint32_t goal_byte = maybe_index.FromJust() * 2;
+  uint32_t goal_byte = maybe_index.FromJust() * BytesPerCharacter(cursor->encoding_);
   int64_t child_index = ts_tree_cursor_goto_first_child_for_byte(&cursor->cursor_, goal_byte);
+  if (child_index >= 0) cursor->exhausted_ = false;
   if (child_index < 0) {
     info.GetReturnValue().Set(Nan::Null());
   } else {
@@ -105,41 +120,210 @@ void TreeCursor::GotoFirstChildForIndex(const Nan::FunctionCallbackInfo<Value> &
 void TreeCursor::GotoNextSibling(const Nan::FunctionCallbackInfo<Value> &info) {
   TreeCursor *cursor = Nan::ObjectWrap::Unwrap<TreeCursor>(info.This());
   bool result = ts_tree_cursor_goto_next_sibling(&cursor->cursor_);
+  if (result) cursor->exhausted_ = false;
   info.GetReturnValue().Set(Nan::New(result));
 }
 
 void TreeCursor::StartPosition(const Nan::FunctionCallbackInfo<Value> &info) {
   TreeCursor *cursor = Nan::ObjectWrap::Unwrap<TreeCursor>(info.This());
   TSNode node = ts_tree_cursor_current_node(&cursor->cursor_);
-  TransferPoint(ts_node_start_point(node));
+  TransferPoint(GetAddonData(info), ts_node_start_point(node), cursor->encoding_);
 }
 
 void TreeCursor::EndPosition(const Nan::FunctionCallbackInfo<Value> &info) {
   TreeCursor *cursor = Nan::ObjectWrap::Unwrap<TreeCursor>(info.This());
   TSNode node = ts_tree_cursor_current_node(&cursor->cursor_);
-  TransferPoint(ts_node_end_point(node));
+  TransferPoint(GetAddonData(info), ts_node_end_point(node), cursor->encoding_);
 }
 
 void TreeCursor::CurrentNode(const Nan::FunctionCallbackInfo<Value> &info) {
   TreeCursor *cursor = Nan::ObjectWrap::Unwrap<TreeCursor>(info.This());
   Local<String> key = Nan::New<String>("tree").ToLocalChecked();
-  const Tree *tree = Tree::UnwrapTree(Nan::Get(info.This(), key).ToLocalChecked());
+  const Tree *tree = Tree::UnwrapTree(GetAddonData(info), Nan::Get(info.This(), key).ToLocalChecked());
   TSNode node = ts_tree_cursor_current_node(&cursor->cursor_);
   node_methods::MarshalNode(info, tree, node);
 }
 
 void TreeCursor::Reset(const Nan::FunctionCallbackInfo<Value> &info) {
   TreeCursor *cursor = Nan::ObjectWrap::Unwrap<TreeCursor>(info.This());
+  AddonData *data = GetAddonData(info);
   Local<String> key = Nan::New<String>("tree").ToLocalChecked();
-  const Tree *tree = Tree::UnwrapTree(Nan::Get(info.This(), key).ToLocalChecked());
-  TSNode node = node_methods::UnmarshalNode(tree);
+  const Tree *tree = Tree::UnwrapTree(data, Nan::Get(info.This(), key).ToLocalChecked());
+  TSNode node = node_methods::UnmarshalNode(data, tree);
   ts_tree_cursor_reset(&cursor->cursor_, node);
+  cursor->root_ = node;
+  cursor->encoding_ = tree->encoding_;
+  cursor->exhausted_ = false;
+}
+
+// Moves to the next node in pre-order, returning to the root and returning
+// false once every node has been visited.
+static bool goto_next_node(TSTreeCursor *cursor, uint32_t *depth) {
+  if (ts_tree_cursor_goto_first_child(cursor)) {
+    (*depth)++;
+    return true;
+  }
+  while (!ts_tree_cursor_goto_next_sibling(cursor)) {
+    if (!ts_tree_cursor_goto_parent(cursor)) return false;
+    (*depth)--;
+  }
+  return true;
+}
+
+// The vendored library can only move a cursor forwards, so the movements
+// below are emulated by walking forwards from the parent or from the root.
+
+void TreeCursor::GotoLastChild(const Nan::FunctionCallbackInfo<Value> &info) {
+  TreeCursor *cursor = Nan::ObjectWrap::Unwrap<TreeCursor>(info.This());
+  bool result = ts_tree_cursor_goto_first_child(&cursor->cursor_);
+  if (result) {
+    cursor->exhausted_ = false;
+    while (ts_tree_cursor_goto_next_sibling(&cursor->cursor_)) {}
+  }
+  info.GetReturnValue().Set(Nan::New(result));
+}
+
+void TreeCursor::GotoPreviousSibling(const Nan::FunctionCallbackInfo<Value> &info) {
+  TreeCursor *cursor = Nan::ObjectWrap::Unwrap<TreeCursor>(info.This());
+  TSNode node = ts_tree_cursor_current_node(&cursor->cursor_);
+  TSTreeCursor walker = ts_tree_cursor_copy(&cursor->cursor_);
+  if (!ts_tree_cursor_goto_parent(&walker)) {
+    ts_tree_cursor_delete(&walker);
+    info.GetReturnValue().Set(Nan::False());
+    return;
+  }
+
+  uint32_t child_count = ts_node_child_count(ts_tree_cursor_current_node(&walker));
+  uint32_t index = 0;
+  bool found = false;
+  if (ts_tree_cursor_goto_first_child(&walker)) {
+    for (; index < child_count; index++) {
+      if (ts_node_eq(ts_tree_cursor_current_node(&walker), node)) {
+        found = true;
+        break;
+      }
+      if (!ts_tree_cursor_goto_next_sibling(&walker)) break;
+    }
+  }
+
+  bool result = found && index > 0;
+  if (result) {
+    ts_tree_cursor_goto_parent(&walker);
+    ts_tree_cursor_goto_first_child(&walker);
+    for (uint32_t i = 1; i < index; i++) {
+      ts_tree_cursor_goto_next_sibling(&walker);
+    }
+    std::swap(cursor->cursor_, walker);
+    cursor->exhausted_ = false;
+  }
+  ts_tree_cursor_delete(&walker);
+  info.GetReturnValue().Set(Nan::New(result));
+}
+
+// Moves to the descendant of the cursor's root with the given pre-order
+// index, returning false and leaving the cursor in place if there isn't one.
+void TreeCursor::GotoDescendant(const Nan::FunctionCallbackInfo<Value> &info) {
+  TreeCursor *cursor = Nan::ObjectWrap::Unwrap<TreeCursor>(info.This());
+  auto maybe_index = Nan::To<uint32_t>(info[0]);
+  if (maybe_index.IsNothing()) {
+    Nan::ThrowTypeError("Argument must be an integer");
+    return;
+  }
+
+  uint32_t goal_index = maybe_index.FromJust();
+  uint32_t depth = 0;
+  TSTreeCursor walker = ts_tree_cursor_new(cursor->root_);
+  bool result = true;
+  for (uint32_t i = 0; i < goal_index; i++) {
+    if (!goto_next_node(&walker, &depth)) {
+      result = false;
+      break;
+    }
+  }
+
+  if (result) {
+    std::swap(cursor->cursor_, walker);
+    cursor->exhausted_ = false;
+  }
+  ts_tree_cursor_delete(&walker);
+  info.GetReturnValue().Set(Nan::New(result));
+}
+
+void TreeCursor::ResetTo(const Nan::FunctionCallbackInfo<Value> &info) {
+  TreeCursor *cursor = Nan::ObjectWrap::Unwrap<TreeCursor>(info.This());
+  AddonData *data = GetAddonData(info);
+  if (!info[0]->IsObject() || !instance_of(info[0], Nan::New(data->tree_cursor_constructor))) {
+    Nan::ThrowTypeError("Argument must be a TreeCursor");
+    return;
+  }
+
+  TreeCursor *other = Nan::ObjectWrap::Unwrap<TreeCursor>(Local<Object>::Cast(info[0]));
+  if (other == cursor) return;
+  ts_tree_cursor_delete(&cursor->cursor_);
+  cursor->cursor_ = ts_tree_cursor_copy(&other->cursor_);
+  cursor->root_ = other->root_;
+  cursor->encoding_ = other->encoding_;
+  cursor->exhausted_ = other->exhausted_;
+}
+
+enum {
+  kCollectDepth,
+  kCollectTypeId,
+  kCollectFieldId,
+  kCollectStartIndex,
+  kCollectEndIndex,
+  kCollectStride,
+};
+
+// Visits nodes in pre-order, starting with the current one, and returns a
+// packed Uint32Array describing the first `maxNodes` of them that pass the
+// filter. The cursor is left on the next node to visit, or on its root if
+// the walk finished, in which case fewer than `maxNodes` nodes are returned
+// and later calls return nothing until the cursor is moved or reset.
+void TreeCursor::Collect(const Nan::FunctionCallbackInfo<Value> &info) {
+  TreeCursor *cursor = Nan::ObjectWrap::Unwrap<TreeCursor>(info.This());
+  auto maybe_max_nodes = Nan::To<uint32_t>(info[0]);
+  if (maybe_max_nodes.IsNothing()) {
+    Nan::ThrowTypeError("Node count must be an integer");
+    return;
+  }
+  uint32_t max_nodes = maybe_max_nodes.FromJust();
+  NodeTypeFilter filter(info[1], Nan::To<bool>(info[2]).FromMaybe(false));
+  uint32_t bytes_per_character = BytesPerCharacter(cursor->encoding_);
+
+  std::vector<uint32_t> result;
+  uint32_t depth = cursor->Depth();
+  uint32_t count = 0;
+  while (!cursor->exhausted_ && count < max_nodes) {
+    TSNode node = ts_tree_cursor_current_node(&cursor->cursor_);
+    if (filter.Matches(node)) {
+      result.push_back(depth);
+      result.push_back(ts_node_symbol(node));
+      result.push_back(ts_tree_cursor_current_field_id(&cursor->cursor_));
+      result.push_back(ts_node_start_byte(node) / bytes_per_character);
+      result.push_back(ts_node_end_byte(node) / bytes_per_character);
+      count++;
+    }
+    if (!goto_next_node(&cursor->cursor_, &depth)) cursor->exhausted_ = true;
+  }
+
+  info.GetReturnValue().Set(NewUint32Array(result.data(), result.size()));
+}
+
+uint32_t TreeCursor::Depth() const {
+  TSTreeCursor copy = ts_tree_cursor_copy(&cursor_);
+  uint32_t depth = 0;
+  while (ts_tree_cursor_goto_parent(&copy)) depth++;
+  ts_tree_cursor_delete(&copy);
+  return depth;
 }
 
 void TreeCursor::NodeType(v8::Local<v8::String> prop, const Nan::PropertyCallbackInfo<v8::Value> &info) {
   TreeCursor *cursor = Nan::ObjectWrap::Unwrap<TreeCursor>(info.This());
   TSNode node = ts_tree_cursor_current_node(&cursor->cursor_);
-  info.GetReturnValue().Set(Nan::New(ts_node_type(node)).ToLocalChecked());
+  info.GetReturnValue().Set(
+    language_methods::TypeName(GetAddonData(info), ts_tree_language(node.tree), ts_node_symbol(node))
+  );
 }
 
 void TreeCursor::NodeIsNamed(v8::Local<v8::String> prop, const Nan::PropertyCallbackInfo<v8::Value> &info) {
@@ -158,22 +342,39 @@ void TreeCursor::NodeIsMissing(v8::Local<v8::String> prop, const Nan::PropertyCa
 
 void TreeCursor::CurrentFieldName(v8::Local<v8::String> prop, const Nan::PropertyCallbackInfo<v8::Value> &info) {
   TreeCursor *cursor = Nan::ObjectWrap::Unwrap<TreeCursor>(info.This());
-  const char *field_name = ts_tree_cursor_current_field_name(&cursor->cursor_);
-  if (field_name) {
-    info.GetReturnValue().Set(Nan::New(field_name).ToLocalChecked());
+  TSFieldId field_id = ts_tree_cursor_current_field_id(&cursor->cursor_);
+  if (field_id) {
+    TSNode node = ts_tree_cursor_current_node(&cursor->cursor_);
+    info.GetReturnValue().Set(
+      language_methods::FieldName(GetAddonData(info), ts_tree_language(node.tree), field_id)
+    );
   }
 }
 
 void TreeCursor::StartIndex(v8::Local<v8::String> prop, const Nan::PropertyCallbackInfo<v8::Value> &info) {
   TreeCursor *cursor = Nan::ObjectWrap::Unwrap<TreeCursor>(info.This());
   TSNode node = ts_tree_cursor_current_node(&cursor->cursor_);
-  info.GetReturnValue().Set(ByteCountToJS(ts_node_start_byte(node)));
+  info.GetReturnValue().Set(ByteCountToJS(ts_node_start_byte(node), cursor->encoding_));
 }
 
 void TreeCursor::EndIndex(v8::Local<v8::String> prop, const Nan::PropertyCallbackInfo<v8::Value> &info) {
   TreeCursor *cursor = Nan::ObjectWrap::Unwrap<TreeCursor>(info.This());
   TSNode node = ts_tree_cursor_current_node(&cursor->cursor_);
-  info.GetReturnValue().Set(ByteCountToJS(ts_node_end_byte(node)));
+  info.GetReturnValue().Set(ByteCountToJS(ts_node_end_byte(node), cursor->encoding_));
+}
+
+void TreeCursor::DescendantIndex(v8::Local<v8::String> prop, const Nan::PropertyCallbackInfo<v8::Value> &info) {
+  TreeCursor *cursor = Nan::ObjectWrap::Unwrap<TreeCursor>(info.This());
+  TSNode node = ts_tree_cursor_current_node(&cursor->cursor_);
+  TSTreeCursor walker = ts_tree_cursor_new(cursor->root_);
+  uint32_t index = 0;
+  uint32_t depth = 0;
+  while (!ts_node_eq(ts_tree_cursor_current_node(&walker), node)) {
+    if (!goto_next_node(&walker, &depth)) break;
+    index++;
+  }
+  ts_tree_cursor_delete(&walker);
+  info.GetReturnValue().Set(Nan::New(index));
 }
 
 }
@@ -5,16 +5,17 @@
 #include <nan.h>
 #include <node_object_wrap.h>
 #include <tree_sitter/api.h>
+#include "./addon_data.h"
 
 namespace node_tree_sitter {
 
 class TreeCursor : public Nan::ObjectWrap {
  public:
-  static void Init(v8::Local<v8::Object> exports);
-  static v8::Local<v8::Value> NewInstance(TSTreeCursor);
+  static void Init(v8::Local<v8::Object> exports, AddonData *);
+  static v8::Local<v8::Value> NewInstance(AddonData *, TSTreeCursor, TSInputEncoding);
 
  private:
-  explicit TreeCursor(TSTreeCursor);
+  TreeCursor(TSTreeCursor, TSInputEncoding);
   ~TreeCursor();
 
   static void New(const Nan::FunctionCallbackInfo<v8::Value> &);
@@ -26,6 +27,11 @@ class TreeCursor : public Nan::ObjectWrap {
   static void EndPosition(const Nan::FunctionCallbackInfo<v8::Value> &);
   static void CurrentNode(const Nan::FunctionCallbackInfo<v8::Value> &);
   static void Reset(const Nan::FunctionCallbackInfo<v8::Value> &);
+  static void GotoLastChild(const Nan::FunctionCallbackInfo<v8::Value> &);
+  static void GotoPreviousSibling(const Nan::FunctionCallbackInfo<v8::Value> &);
+  static void GotoDescendant(const Nan::FunctionCallbackInfo<v8::Value> &);
+  static void ResetTo(const Nan::FunctionCallbackInfo<v8::Value> &);
+  static void Collect(const Nan::FunctionCallbackInfo<v8::Value> &);
 
   static void NodeType(v8::Local<v8::String>, const Nan::PropertyCallbackInfo<v8::Value> &);
   static void NodeIsNamed(v8::Local<v8::String>, const Nan::PropertyCallbackInfo<v8::Value> &);
@@ -33,10 +39,15 @@ class TreeCursor : public Nan::ObjectWrap {
   static void CurrentFieldName(v8::Local<v8::String>, const Nan::PropertyCallbackInfo<v8::Value> &);
   static void StartIndex(v8::Local<v8::String>, const Nan::PropertyCallbackInfo<v8::Value> &);
   static void EndIndex(v8::Local<v8::String>, const Nan::PropertyCallbackInfo<v8::Value> &);
+  static void DescendantIndex(v8::Local<v8::String>, const Nan::PropertyCallbackInfo<v8::Value> &);
+
+  uint32_t Depth() const;
 
   TSTreeCursor cursor_;
-  static Nan::Persistent<v8::Function> constructor;
-  static Nan::Persistent<v8::FunctionTemplate> constructor_template;
+  TSNode root_;
+  TSInputEncoding encoding_;
+  // Whether `collect` has visited every node, leaving the cursor on its root.
+  bool exhausted_;
 };
 
 }  // namespace node_tree_sitter
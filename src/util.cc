@@ -1,3 +1,4 @@
+#include <cstring>
 #include <v8.h>
 #include <nan.h>
 #include "./util.h"
@@ -19,4 +20,25 @@ v8::Local<v8::Object> GetGlobal(v8::Local<v8::Function>& callback) {
   #endif
 }
 
+v8::Local<v8::Uint32Array> NewUint32Array(const uint32_t *values, size_t length) {
+  auto buffer = v8::ArrayBuffer::New(v8::Isolate::GetCurrent(), length * sizeof(uint32_t));
+  auto array = v8::Uint32Array::New(buffer, 0, length);
+  if (length > 0) {
+    Nan::TypedArrayContents<uint32_t> contents(array);
+    memcpy(*contents, values, length * sizeof(uint32_t));
+  }
+  return array;
+}
+
+NodeTypeFilter::NodeTypeFilter(v8::Local<v8::Value> type_set, bool named_only)
+  : type_set_(type_set), has_type_set_(type_set->IsUint8Array()), named_only_(named_only) {}
+
+bool NodeTypeFilter::Matches(TSNode node) const {
+  if (named_only_ && !ts_node_is_named(node)) return false;
+  if (!has_type_set_) return true;
+  TSSymbol symbol = ts_node_symbol(node);
+  size_t byte = symbol >> 3;
+  return byte < type_set_.length() && ((*type_set_)[byte] & (1 << (symbol & 7)));
+}
+
 }  // namespace node_tree_sitter
@@ -3,6 +3,7 @@
 
 #include <v8.h>
 #include <nan.h>
+#include <tree_sitter/api.h>
 
 namespace node_tree_sitter {
 
@@ -22,6 +23,22 @@ bool instance_of(v8::Local<v8::Value> value, v8::Local<v8::Object> object);
 
 v8::Local<v8::Object> GetGlobal(v8::Local<v8::Function>& callback);
 
+v8::Local<v8::Uint32Array> NewUint32Array(const uint32_t *values, size_t length);
+
+// Selects nodes by symbol, using a bitset built by `buildNodeTypeSet` in
+// index.js (or anything other than a Uint8Array to select every symbol),
+// and optionally only named nodes.
+class NodeTypeFilter {
+ public:
+  NodeTypeFilter(v8::Local<v8::Value> type_set, bool named_only);
+  bool Matches(TSNode) const;
+
+ private:
+  Nan::TypedArrayContents<uint8_t> type_set_;
+  bool has_type_set_;
+  bool named_only_;
+};
+
 }  // namespace node_tree_sitter
 
 #endif  // NODE_TREE_SITTER_UTIL_H_
@@ -91,6 +91,32 @@ describe("Node", () => {
         quotientNode.children.map(child => child.endIndex)
       );
     });
+
+    it("stays up to date with edits when called from optimized code", () => {
+      const tree = parser.parse("abc + cde");
+      const sumNode = tree.rootNode.firstChild.firstChild;
+      const rightNode = sumNode.lastChild;
+      const readIndices = () => {
+        let result;
+        for (let i = 0; i < 20000; i++) {
+          result = [rightNode.startIndex, rightNode.endIndex, rightNode.childCount, rightNode.isNamed];
+        }
+        return result;
+      };
+      assert.deepEqual(readIndices(), [6, 9, 0, true]);
+
+      tree.edit({
+        startIndex: 0,
+        oldEndIndex: 0,
+        newEndIndex: 3,
+        startPosition: {row: 0, column: 0},
+        oldEndPosition: {row: 0, column: 0},
+        newEndPosition: {row: 0, column: 3},
+      });
+      assert.deepEqual(readIndices(), [9, 12, 0, true]);
+      assert.equal(rightNode.startPosition.column, 9);
+      assert.deepEqual(readIndices(), [9, 12, 0, true]);
+    });
   });
 
   describe(".startPosition and .endPosition", () => {
@@ -331,6 +357,85 @@ describe("Node", () => {
     });
   });
 
+  describe('.select(selector)', () => {
+    const source = "class A { b() { c(d); } e() {} }\nf(g);";
+
+    it('returns the descendants that match the selector, in document order', () => {
+      const tree = parser.parse(source);
+      assert.deepEqual(
+        tree.rootNode.select('class_declaration method_definition > property_identifier[field=name]').map(node => node.text),
+        ['b', 'e']
+      );
+      assert.deepEqual(
+        tree.rootNode.select('call_expression > identifier').map(node => node.text),
+        ['c', 'f']
+      );
+      assert.deepEqual(
+        tree.rootNode.select('method_definition [field=function], program > expression_statement _').map(node => node.text),
+        ['c', 'f(g)', 'f', '(g)', 'g']
+      );
+      assert.deepEqual(
+        tree.rootNode.select('arguments > "("').map(node => node.startIndex),
+        [17, 34]
+      );
+    });
+
+    it('only matches within the node', () => {
+      const tree = parser.parse(source);
+      const method = tree.rootNode.selectFirst('method_definition');
+      assert.equal(method.text, 'b() { c(d); }');
+      assert.deepEqual(method.select('identifier').map(node => node.text), ['c', 'd']);
+      assert.deepEqual(method.select('class_declaration identifier'), []);
+      assert.equal(method.selectFirst('class_body'), null);
+    });
+
+    it('accepts a precompiled selector', () => {
+      const tree = parser.parse(source);
+      const selector = new Parser.Selector(JavaScript, 'arguments identifier');
+      assert.deepEqual(tree.rootNode.select(selector).map(node => node.text), ['d', 'g']);
+    });
+
+    it('throws an exception when the selector is invalid', () => {
+      const tree = parser.parse(source);
+      assert.throws(() => tree.rootNode.select('method_definition > nonexistent'), /unknown node type 'nonexistent' at position 20/);
+      assert.throws(() => tree.rootNode.select('identifier[field=nonexistent]'), /unknown field/);
+      assert.throws(() => tree.rootNode.select('identifier,'), /expected a node type/);
+    });
+  });
+
+  describe('with a precompiled type set', () => {
+    it('finds the same nodes as with type names', () => {
+      const types = JavaScript.typeSet(['identifier', 'number']);
+      const tree = parser.parse("a + 1 * b * 2 + c + 3");
+      assert.deepEqual(
+        tree.rootNode.descendantsOfType(types).map(node => node.startIndex),
+        [0, 4, 8, 12, 16, 20]
+      );
+
+      const number = tree.rootNode.descendantForIndex(4);
+      assert.isTrue(types.has(number.typeId));
+      assert.isFalse(types.has(number.parent.typeId));
+      assert.equal(
+        number.closest(JavaScript.typeSet('program')).type,
+        'program'
+      );
+    });
+
+    it('can be passed to traversals', () => {
+      const tree = parser.parse("a + 1");
+      const types = [];
+      tree.traverse({
+        types: JavaScript.typeSet('number'),
+        enter(node) { types.push(node.type); }
+      });
+      assert.deepEqual(types, ['number']);
+    });
+
+    it('throws an exception when an invalid argument is given', () => {
+      assert.throws(() => JavaScript.typeSet({a: 1}), /Argument must be a string or array of strings/);
+    });
+  });
+
   describe(".firstChildForIndex(index)", () => {
     it("returns the first child that extends beyond the given index", () => {
       const tree = parser.parse("x10 + 1000");
@@ -371,6 +476,22 @@ describe("Node", () => {
     });
   });
 
+  describe(".type", () => {
+    it("returns the names of node types, including errors", () => {
+      const tree = parser.parse("1 + 2 * * 3");
+      const errors = tree.rootNode.descendantsOfType("ERROR");
+      assert.equal(errors.length, 1);
+      assert.equal(errors[0].type, "ERROR");
+
+      const cursor = tree.walk();
+      const types = new Set();
+      do {
+        types.add(cursor.nodeType);
+      } while (cursor.gotoFirstChild());
+      assert.deepEqual(Array.from(types), ["program", "expression_statement", "binary_expression", "number"]);
+    });
+  });
+
   describe(".isMissing()", () => {
     it("returns true if the node is missing from the source and was inserted via error recovery", () => {
       const tree = parser.parse("(2 ||)");
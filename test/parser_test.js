@@ -1,6 +1,8 @@
 const Parser = require("..");
 const JavaScript = require('tree-sitter-javascript');
 const { assert } = require("chai");
+const { Worker } = require("worker_threads");
+const path = require("path");
 
 describe("Parser", () => {
   let parser;
@@ -92,6 +94,49 @@ describe("Parser", () => {
     });
   });
 
+  describe(".setLogBuffer", () => {
+    beforeEach(() => {
+      parser.setLanguage(JavaScript);
+    });
+
+    it("records log messages until they are drained", () => {
+      parser.setLogBuffer({types: ['parse']});
+      parser.parse("a + b + c");
+      const records = parser.drainLog();
+      assert.isAbove(records.length, 0);
+      assert.isTrue(records.every(record => record.type === 'parse'));
+      assert.isTrue(records.some(record => record.message.startsWith('reduce')));
+      assert.deepEqual(parser.drainLog(), []);
+    });
+
+    it("keeps the most recent messages when the buffer is full", () => {
+      parser.setLogBuffer({capacity: 256});
+      parser.parse("a + b + c");
+      const raw = parser.drainLog({raw: true});
+      assert.isAtMost(raw.length, 256);
+
+      parser.setLogger(false);
+      parser.parse("a + b + c");
+      assert.isNull(parser.drainLog());
+    });
+
+    it("only records sampled parses", () => {
+      parser.setLogBuffer({sampleInterval: 2});
+      parser.parse("a");
+      const first = parser.drainLog();
+      parser.parse("a");
+      assert.deepEqual(parser.drainLog(), []);
+      parser.parse("a");
+      assert.deepEqual(parser.drainLog(), first);
+    });
+
+    it("can be used with asynchronous parses", async () => {
+      parser.setLogBuffer();
+      await parser.parseAsync("a + b");
+      assert.isAbove(parser.drainLog().length, 0);
+    });
+  });
+
   describe(".parse", () => {
     beforeEach(() => {
       parser.setLanguage(JavaScript);
@@ -133,6 +178,77 @@ describe("Parser", () => {
       assert.equal(tree.rootNode.firstChild.firstChild.namedChildCount, repeatCount);
     });
 
+    describe("when the input is a Buffer", () => {
+      it("parses it as UTF-8 and reports byte offsets", () => {
+        const tree = parser.parse(Buffer.from("αβ + c;"));
+        const binary = tree.rootNode.firstChild.firstChild;
+        assert.equal(binary.type, "binary_expression");
+        assert.equal(binary.startIndex, 0);
+        assert.equal(binary.endIndex, 8);
+        assert.deepEqual(binary.endPosition, {row: 0, column: 8});
+        assert.equal(binary.leftNode.text, "αβ");
+        assert.equal(binary.rightNode.startIndex, 7);
+        assert.equal(binary.rightNode.text, "c");
+      });
+
+      it("accepts a plain Uint8Array", () => {
+        const tree = parser.parse(new TextEncoder().encode("a + b"));
+        assert.equal(tree.rootNode.firstChild.text, "a + b");
+      });
+
+      it("rejects UTF-8 encoding for non-Buffer input", () => {
+        assert.throws(() => parser.parse("a", null, {encoding: "utf8"}), /UTF-8 input/);
+      });
+
+      it("rejects an old tree with a different encoding", () => {
+        const oldTree = parser.parse("a + b");
+        assert.throws(() => parser.parse(Buffer.from("a + b"), oldTree), /same encoding/);
+      });
+    });
+
+    it("returns null when no language has been set", () => {
+      assert.equal(new Parser().parse("a + b"), null);
+    });
+
+    describe("when the `timeoutMicros` option is given", () => {
+      it("throws ETIMEDOUT when the timeout elapses, and resumes on the next call", () => {
+        const inputString = "[" + "0,".repeat(100000) + "]";
+        const error = assert.throws(() => parser.parse(inputString, null, {timeoutMicros: 1}), /timed out/);
+        assert.equal(error.code, "ETIMEDOUT");
+
+        const tree = parser.parse(inputString);
+        assert.equal(tree.rootNode.firstChild.firstChild.namedChildCount, 100000);
+      });
+    });
+
+    describe("when the `cancellationFlag` option is given", () => {
+      it("throws ECANCELED while the flag is set", () => {
+        const cancellationFlag = new Int32Array(new SharedArrayBuffer(8));
+        Atomics.store(cancellationFlag, 0, 1);
+        const error = assert.throws(() => parser.parse("a + b", null, {cancellationFlag}), /cancelled/);
+        assert.equal(error.code, "ECANCELED");
+
+        Atomics.store(cancellationFlag, 0, 0);
+        const tree = parser.parse("a + b", null, {cancellationFlag});
+        assert.equal(tree.rootNode.firstChild.text, "a + b");
+      });
+
+      it("rejects flags that are too small", () => {
+        assert.throws(() => parser.parse("a", null, {cancellationFlag: new Uint8Array(1)}), /Cancellation flag/);
+      });
+    });
+
+    describe(".reset", () => {
+      it("discards an interrupted parse", () => {
+        const inputString = "[" + "0,".repeat(100000) + "]";
+        assert.throws(() => parser.parse(inputString, null, {timeoutMicros: 1}), /timed out/);
+
+        parser.reset();
+        const tree = parser.parse("a + b");
+        assert.equal(tree.rootNode.toString(), "(program (expression_statement (binary_expression left: (identifier) right: (identifier))))");
+      });
+    });
+
     describe('when the `includedRanges` option is given', () => {
       it('parses the text within those ranges of the string', () => {
         const sourceCode = "<% foo() %> <% bar %>";
@@ -166,4 +282,334 @@ describe("Parser", () => {
       })
     })
   });
+
+  describe(".parseAsync", () => {
+    beforeEach(() => {
+      parser.setLanguage(JavaScript);
+    });
+
+    it("resolves with the parsed tree", async () => {
+      const tree = await parser.parseAsync("a + b");
+      assert.equal(
+        tree.rootNode.toString(),
+        "(program (expression_statement (binary_expression left: (identifier) right: (identifier))))"
+      );
+      assert.equal(tree.rootNode.firstChild.text, "a + b");
+    });
+
+    it("reads the whole input when given a function", async () => {
+      const parts = ["first", "_", "second", "_", "third"];
+      const tree = await parser.parseAsync(() => parts.shift());
+      assert.equal(tree.rootNode.toString(), "(program (expression_statement (identifier)))");
+      assert.equal(tree.rootNode.endIndex, 18);
+    });
+
+    it("reuses the old tree", async () => {
+      const oldTree = await parser.parseAsync("abc + cde");
+      oldTree.edit({
+        startIndex: 3,
+        oldEndIndex: 3,
+        newEndIndex: 7,
+        startPosition: {row: 0, column: 3},
+        oldEndPosition: {row: 0, column: 3},
+        newEndPosition: {row: 0, column: 7},
+      });
+      const tree = await parser.parseAsync("abc * d + cde", oldTree);
+      assert.equal(
+        tree.rootNode.toString(),
+        "(program (expression_statement (binary_expression left: (binary_expression left: (identifier) right: (identifier)) right: (identifier))))"
+      );
+    });
+
+    it("does not allow the parser to be used until the parse completes", async () => {
+      const promise = parser.parseAsync("a + b");
+      assert.throws(() => parser.parse("c"), /Parser is busy/);
+      await promise;
+      assert.equal(parser.parse("c").rootNode.type, "program");
+    });
+
+    it("rejects when the input is invalid", async () => {
+      let error;
+      try {
+        await parser.parseAsync(5);
+      } catch (e) {
+        error = e;
+      }
+      assert.match(error.message, /Input.*string, a Buffer or a function/);
+    });
+
+    it("rejects with ECANCELED when the cancellation flag is set", async () => {
+      const cancellationFlag = new Int32Array(new SharedArrayBuffer(8));
+      Atomics.store(cancellationFlag, 0, 1);
+      let error;
+      try {
+        await parser.parseAsync("a + b", null, {cancellationFlag});
+      } catch (e) {
+        error = e;
+      }
+      assert.equal(error.code, "ECANCELED");
+      assert.equal(parser.parse("a + b").rootNode.firstChild.text, "a + b");
+    });
+  });
+
+  describe(".reparse", () => {
+    beforeEach(() => {
+      parser.setLanguage(JavaScript);
+    });
+
+    const edit = {
+      startIndex: 3,
+      oldEndIndex: 3,
+      newEndIndex: 7,
+      startPosition: {row: 0, column: 3},
+      oldEndPosition: {row: 0, column: 3},
+      newEndPosition: {row: 0, column: 7},
+    };
+
+    it("edits the old tree, reparses and reports the changed ranges", () => {
+      const oldTree = parser.parse("abc + cde");
+      const {tree, changedRanges} = parser.reparse(oldTree, [edit], "abc * d + cde");
+      assert.equal(
+        tree.rootNode.toString(),
+        "(program (expression_statement (binary_expression left: (binary_expression left: (identifier) right: (identifier)) right: (identifier))))"
+      );
+
+      const expected = oldTree.getChangedRanges(tree);
+      assert.equal(changedRanges.length, expected.length * Parser.CHANGED_RANGE_STRIDE);
+      expected.forEach((range, i) => {
+        assert.deepEqual(
+          Array.from(changedRanges.subarray(i * Parser.CHANGED_RANGE_STRIDE, (i + 1) * Parser.CHANGED_RANGE_STRIDE)),
+          [
+            range.startIndex, range.endIndex,
+            range.startPosition.row, range.startPosition.column,
+            range.endPosition.row, range.endPosition.column
+          ]
+        );
+      });
+      assert.isAbove(changedRanges.length, 0);
+    });
+
+    it("throws ETIMEDOUT when the timeout elapses, leaving the tree edited", () => {
+      const oldTree = parser.parse("abc + cde");
+      const inputString = "abc * d + cde;" + "[" + "0,".repeat(100000) + "]";
+      const error = assert.throws(
+        () => parser.reparse(oldTree, [edit], inputString, {timeoutMicros: 1}),
+        /timed out/
+      );
+      assert.equal(error.code, "ETIMEDOUT");
+      assert.equal(oldTree.rootNode.endIndex, 13);
+      parser.reset();
+    });
+
+    it("accepts packed edits", () => {
+      const oldTree = parser.parse("abc + cde");
+      const edits = Int32Array.of(3, 3, 7, 0, 3, 0, 3, 0, 7);
+      const {tree} = parser.reparse(oldTree, edits, "abc * d + cde");
+      assert.equal(tree.rootNode.firstChild.text, "abc * d + cde");
+    });
+
+    it("requires an old tree", () => {
+      assert.throws(() => parser.reparse(null, [], "a"), /Old tree/);
+    });
+
+    it("leaves the old tree unedited when an argument is invalid", () => {
+      const oldTree = parser.parse("abc + cde");
+      assert.throws(() => parser.reparse(oldTree, [edit], "abc * d + cde", {timeoutMicros: -1}), /Timeout/);
+      assert.throws(() => parser.reparse(oldTree, [edit], "abc * d + cde", {includedRanges: [null]}));
+      assert.equal(oldTree.rootNode.endIndex, 9);
+    });
+  });
+
+  describe(".stats", () => {
+    beforeEach(() => {
+      parser.setLanguage(JavaScript);
+    });
+
+    it("sums the stats of the parser's parses", () => {
+      const before = parser.stats();
+      const tree = parser.parse("let x = 1;");
+      parser.parse("let x = 12;", tree.edit({
+        startIndex: 9,
+        oldEndIndex: 9,
+        newEndIndex: 10,
+        startPosition: {row: 0, column: 9},
+        oldEndPosition: {row: 0, column: 9},
+        newEndPosition: {row: 0, column: 10},
+      }));
+      const after = parser.stats();
+      assert.equal(after.parseCount - before.parseCount, 2);
+      assert.equal(after.incrementalParseCount - before.incrementalParseCount, 1);
+      assert.isAbove(after.bytesRead, before.bytesRead);
+      assert.isAtLeast(after.wallTime, before.wallTime);
+    });
+
+    it("records the stats of each tree, including reused nodes", () => {
+      const source = "let a = 1;\nlet b = 2;\nlet c = 3;";
+      const tree = parser.parse(source);
+      const stats = tree.parseStats;
+      assert.isFalse(stats.incremental);
+      assert.equal(stats.reusedNodeCount, 0);
+      assert.equal(stats.newNodeCount, stats.nodeCount);
+
+      tree.edit({
+        startIndex: 0,
+        oldEndIndex: 3,
+        newEndIndex: 5,
+        startPosition: {row: 0, column: 0},
+        oldEndPosition: {row: 0, column: 3},
+        newEndPosition: {row: 0, column: 5},
+      });
+      assert.isNull(parser.parse("const" + source.slice(3), tree).parseStats.reusedNodeCount);
+
+      parser.setCountNewNodes(true);
+      const newTree = parser.parse("const" + source.slice(3), tree);
+      parser.setCountNewNodes(false);
+      const newStats = newTree.parseStats;
+      assert.isTrue(newStats.incremental);
+      assert.isAbove(newStats.reusedNodeCount, 0);
+      assert.equal(newStats.newNodeCount + newStats.reusedNodeCount, newStats.nodeCount);
+    });
+  });
+
+  describe(".parseMany", () => {
+    it("resolves with the trees in input order", async () => {
+      const sources = ["a + b", "c(d)", "e.f", "[g]", "h = i"];
+      const trees = await Parser.parseMany(
+        sources.map(input => ({input, language: JavaScript})),
+        {concurrency: 3}
+      );
+      assert.deepEqual(trees.map(tree => tree.rootNode.firstChild.text), sources);
+    });
+
+    it("reports failures per file without failing the batch", async () => {
+      const reported = [];
+      const trees = await Parser.parseMany(
+        [
+          {input: "a", language: JavaScript},
+          {input: 5, language: JavaScript},
+          {input: Buffer.from("b"), language: {}},
+          {input: Buffer.from("c"), language: JavaScript},
+        ],
+        {onFile: (index, error, tree) => reported.push([index, error && error.message, !!tree])}
+      );
+
+      assert.equal(trees[0].rootNode.text, "a");
+      assert.equal(trees[1], null);
+      assert.equal(trees[2], null);
+      assert.equal(trees[3].rootNode.text, "c");
+
+      reported.sort((a, b) => a[0] - b[0]);
+      assert.deepEqual(reported.map(([index, , parsed]) => [index, parsed]), [
+        [0, true], [1, false], [2, false], [3, true],
+      ]);
+      assert.match(reported[1][1], /Input must be/);
+      assert.match(reported[2][1], /Invalid language/);
+    });
+
+    it("reuses old trees", async () => {
+      const oldTree = parser.parse("abc + cde");
+      oldTree.edit({
+        startIndex: 3,
+        oldEndIndex: 3,
+        newEndIndex: 7,
+        startPosition: {row: 0, column: 3},
+        oldEndPosition: {row: 0, column: 3},
+        newEndPosition: {row: 0, column: 7},
+      });
+      const [tree] = await Parser.parseMany([{input: "abc * d + cde", language: JavaScript, oldTree}]);
+      assert.equal(tree.rootNode.firstChild.text, "abc * d + cde");
+      assert.deepEqual(tree.getChangedRanges(oldTree).map(r => r.startIndex), [0]);
+    });
+
+    it("initializes languages that were never set on a parser", async () => {
+      // A worker loads its own copy of the language, which no parser has seen.
+      const type = await new Promise((resolve, reject) => {
+        const worker = new Worker(`
+          const { parentPort, workerData } = require("worker_threads");
+          const Parser = require(workerData.treeSitterPath);
+          const JavaScript = require(workerData.javascriptPath);
+          Parser.parseMany([{input: "a + b", language: JavaScript}]).then(([tree]) => {
+            parentPort.postMessage(tree.rootNode.firstChild.type);
+          });
+        `, {
+          eval: true,
+          workerData: {
+            treeSitterPath: path.join(__dirname, ".."),
+            javascriptPath: require.resolve("tree-sitter-javascript"),
+          },
+        });
+        worker.once("message", resolve);
+        worker.once("error", reject);
+      });
+      assert.equal(type, "expression_statement");
+    });
+
+    it("defines typeSet on languages that were never set on a parser", async () => {
+      const ids = await new Promise((resolve, reject) => {
+        const worker = new Worker(`
+          const { parentPort, workerData } = require("worker_threads");
+          const Parser = require(workerData.treeSitterPath);
+          const JavaScript = require(workerData.javascriptPath);
+          const promise = Parser.parseMany([{input: "a + b", language: JavaScript}]);
+          const identifiers = JavaScript.typeSet("identifier");
+          promise.then(([tree]) => {
+            parentPort.postMessage(tree.rootNode.descendantsOfType(identifiers).map(node => node.text));
+          });
+        `, {
+          eval: true,
+          workerData: {
+            treeSitterPath: path.join(__dirname, ".."),
+            javascriptPath: require.resolve("tree-sitter-javascript"),
+          },
+        });
+        worker.once("message", resolve);
+        worker.once("error", reject);
+      });
+      assert.deepEqual(ids, ["a", "b"]);
+    });
+  });
+
+  describe("in worker threads", () => {
+    const workerSource = `
+      const { parentPort, workerData } = require("worker_threads");
+      const Parser = require(workerData.treeSitterPath);
+      const JavaScript = require(workerData.javascriptPath);
+      const parser = new Parser();
+      parser.setLanguage(JavaScript);
+      const query = new Parser.Query(JavaScript, "(identifier) @id");
+      const tree = parser.parse(workerData.source);
+      parentPort.postMessage({
+        sexp: tree.rootNode.toString(),
+        ids: query.captures(tree.rootNode).map(({node}) => node.text),
+      });
+    `;
+
+    function runWorker(source) {
+      return new Promise((resolve, reject) => {
+        const worker = new Worker(workerSource, {
+          eval: true,
+          workerData: {
+            treeSitterPath: path.join(__dirname, ".."),
+            javascriptPath: require.resolve("tree-sitter-javascript"),
+            source,
+          },
+        });
+        worker.once("message", resolve);
+        worker.once("error", reject);
+      });
+    }
+
+    it("loads independently in several workers at once", async () => {
+      const results = await Promise.all([
+        runWorker("a + b"),
+        runWorker("c(d)"),
+        runWorker("e.f = g"),
+      ]);
+      assert.deepEqual(results.map(r => r.ids), [["a", "b"], ["c", "d"], ["e", "g"]]);
+
+      // The main thread's instance is unaffected by the workers.
+      parser.setLanguage(JavaScript);
+      assert.equal(parser.parse("h").rootNode.firstChild.text, "h");
+    });
+  });
 });
@@ -76,6 +76,153 @@ describe("Query", () => {
     });
   });
 
+  describe(".iterMatches", () => {
+    const query = new Query(JavaScript, "(identifier) @element");
+
+    it("yields the matches lazily, in batches", () => {
+      const tree = parser.parse("[a, b, c, d, e]");
+      const iterator = query.iterMatches(tree.rootNode, {batchSize: 2});
+      assert.deepEqual(formatMatches(tree, [iterator.next().value]), [
+        { pattern: 0, captures: [{ name: "element", text: "a" }] },
+      ]);
+      assert.deepEqual(formatMatches(tree, [...iterator]).map(m => m.captures[0].text), ["b", "c", "d", "e"]);
+      assert.isTrue(iterator.next().done);
+      assert.isFalse(iterator.didExceedMatchLimit);
+    });
+
+    it("can search in a byte range", () => {
+      const tree = parser.parse("[a, b, c, d, e]");
+      const matches = [...query.iterMatches(tree.rootNode, {startIndex: 4, endIndex: 8})];
+      assert.deepEqual(formatMatches(tree, matches).map(m => m.captures[0].text), ["b", "c"]);
+    });
+
+    it("throws if the tree is edited between batches", () => {
+      const tree = parser.parse("[a, b, c]");
+      const iterator = query.iterMatches(tree.rootNode, {batchSize: 1});
+      assert.equal(iterator.next().value.captures[0].node.text, "a");
+
+      tree.edit({
+        startIndex: 0,
+        oldEndIndex: 0,
+        newEndIndex: 1,
+        startPosition: {row: 0, column: 0},
+        oldEndPosition: {row: 0, column: 0},
+        newEndPosition: {row: 0, column: 1},
+      });
+      assert.throws(() => iterator.next(), /edited/);
+      assert.isTrue(iterator.next().done);
+    });
+
+    it("can interleave several executions", () => {
+      const tree = parser.parse("[a, b, c]");
+      const first = query.iterMatches(tree.rootNode, {batchSize: 1});
+      const second = query.iterMatches(tree.rootNode, {batchSize: 1});
+      assert.instanceOf(first.cursor, QueryCursor);
+      assert.throws(() => new QueryCursor(), TypeError);
+
+      const texts = [];
+      for (const match of first) {
+        texts.push(match.captures[0].node.text, second.next().value.captures[0].node.text);
+        texts.push(query.matches(tree.rootNode).length);
+      }
+      assert.deepEqual(texts, ["a", "a", 3, "b", "b", 3, "c", "c", 3]);
+    });
+
+    it("can run queries while another query is reading the source text", () => {
+      const source = "a; b;";
+      const other = parser.parse("[c, d]");
+      const nestedResults = [];
+      let tree = null;
+      tree = parser.parse(index => {
+        if (tree) nestedResults.push(query.matches(other.rootNode).length);
+        return source.slice(index);
+      });
+      const matches = new Query(JavaScript, `((identifier) @id (#not-eq? @id "a"))`).matches(tree.rootNode);
+      assert.deepEqual(formatMatches(tree, matches), [
+        { pattern: 0, captures: [{ name: "id", text: "b" }] },
+      ]);
+      assert.isNotEmpty(nestedResults);
+      assert.isTrue(nestedResults.every(count => count === 2));
+    });
+
+    it("reports when the match limit is exceeded", () => {
+      const tree = parser.parse("a(b(c(d(e))));");
+      const nested = new Query(JavaScript, "(call_expression (arguments (_) @arg)) @call");
+      const iterator = nested.iterMatches(tree.rootNode, {matchLimit: 1});
+      [...iterator];
+      assert.isTrue(iterator.didExceedMatchLimit);
+    });
+  });
+
+  describe(".rawCaptures", () => {
+    it("returns the captures' ranges in a Uint32Array", () => {
+      const tree = parser.parse("const ÄB = c(Äd);");
+      const query = new Query(JavaScript, `
+        (call_expression function: (identifier) @fn)
+        ((identifier) @constant (#match? @constant "B$"))
+        ((identifier) @id (#not-eq? @id "c"))
+      `);
+      assert.deepEqual(query.captureNames, ["fn", "constant", "id"]);
+
+      const records = query.rawCaptures(tree.rootNode);
+      assert.instanceOf(records, Uint32Array);
+      const stride = Query.RAW_CAPTURE_STRIDE;
+      const captures = [];
+      for (let i = 0; i < records.length; i += stride) {
+        captures.push([
+          records[i],
+          query.captureNames[records[i + 1]],
+          tree.rootNode.text.slice(records[i + 2], records[i + 3]),
+        ]);
+      }
+      assert.deepEqual(captures, [
+        [1, "constant", "ÄB"],
+        [2, "id", "ÄB"],
+        [0, "fn", "c"],
+        [2, "id", "Äd"],
+      ]);
+    });
+
+    it("uses byte offsets for UTF-8 buffers", () => {
+      const tree = parser.parse(Buffer.from("Ä(b);"));
+      const query = new Query(JavaScript, "(identifier) @id");
+      assert.deepEqual(
+        Array.from(query.rawCaptures(tree.rootNode, {startIndex: 3})).filter((_, i) => i % 6 !== 4 && i % 6 !== 5),
+        [0, 0, 3, 4]
+      );
+    });
+
+    it("evaluates #match? the same way natively and in JavaScript", () => {
+      const source = "Äa; a.b; ab; ba; $a; a$; b$a; a$b; _Ä; x_Ä;";
+      const patterns = [
+        // Evaluated natively
+        "a", "^a", "a$", "^a$", "Ä", "^Ä", "_Ä$", "\\$a", "a\\$", "^\\$", "", "^$",
+        // Evaluated in JavaScript
+        "^[ab]+$", "a|b", "^.a", "\\w\\$", "(?<=b)a",
+      ];
+      for (const encoding of ["utf16", "utf8"]) {
+        const tree = parser.parse(encoding === "utf8" ? Buffer.from(source) : source);
+        const identifiers = tree.rootNode.descendantsOfType("identifier").map(node => node.text);
+        for (const pattern of patterns) {
+          const escaped = pattern.replace(/\\/g, "\\\\");
+          const query = new Query(JavaScript, `((identifier) @id (#match? @id "${escaped}"))`);
+          const regex = new RegExp(pattern);
+          assert.deepEqual(
+            query.captures(tree.rootNode).map(c => c.node.text),
+            identifiers.filter(text => regex.test(text)),
+            `${encoding} ${pattern}`
+          );
+        }
+      }
+    });
+
+    it("rejects queries with predicates that need JavaScript", () => {
+      const tree = parser.parse("a;");
+      const query = new Query(JavaScript, `((identifier) @id (#match? @id "(?<=)a"))`);
+      assert.throws(() => query.rawCaptures(tree.rootNode), /predicates/);
+    });
+  });
+
   describe(".captures", () => {
     it("returns all of the captures for the given query, in order", () => {
       const tree = parser.parse(`
@@ -193,6 +340,39 @@ describe("Query", () => {
         },
       ]);
     });
+
+    it("evaluates text predicates for every kind of input", () => {
+      const source = "const Ärger = ärger; const PI = Math.PI; foo(PI);";
+      const query = new Query(JavaScript, `
+        ((identifier) @constant (#match? @constant "^[A-ZÄ]{2,}$"))
+        ((identifier) @upper (#match? @upper "^Ä"))
+        ((identifier) @foo (#not-eq? @foo "foo") (#eq? @foo "ärger"))
+      `);
+
+      const trees = [
+        parser.parse(source),
+        parser.parse(Buffer.from(source)),
+        parser.parse(index => source.slice(index, index + 3)),
+      ];
+      for (const tree of trees) {
+        assert.deepEqual(formatCaptures(tree, query.captures(tree.rootNode)), [
+          { name: "upper", text: "Ärger" },
+          { name: "foo", text: "ärger" },
+          { name: "constant", text: "PI" },
+          { name: "constant", text: "PI" },
+        ]);
+      }
+    });
+
+    it("falls back to JavaScript for regexes the native engine can't compile", () => {
+      const tree = parser.parse("a.b; c.d;");
+      const query = new Query(JavaScript, `
+        ((property_identifier) @prop (#match? @prop "(?<=)d"))
+      `);
+      assert.deepEqual(formatCaptures(tree, query.captures(tree.rootNode)), [
+        { name: "prop", text: "d" },
+      ]);
+    });
   });
 });
 
@@ -1,6 +1,7 @@
 const Parser = require("..");
 const JavaScript = require('tree-sitter-javascript');
 const { assert } = require("chai");
+const fs = require("fs");
 
 describe("Tree", () => {
   let parser;
@@ -69,6 +70,328 @@ describe("Tree", () => {
         "(program (expression_statement (binary_expression left: (binary_expression left: (identifier) right: (identifier)) right: (identifier))))"
       );
     });
+
+    it("updates nodes that were retrieved between edits", () => {
+      input = 'abc + cde';
+      tree = parser.parse(input);
+      const variableNode1 = tree.rootNode.firstChild.firstChild.firstChild;
+
+      ([input, edit] = spliceInput(input, 0, 0, 'x + '));
+      tree.edit(edit);
+      const variableNode2 = tree.rootNode.firstChild.firstChild.lastChild;
+      assert.equal(variableNode2.startIndex, 10);
+
+      ([input, edit] = spliceInput(input, 0, 0, 'y + '));
+      tree.edit(edit);
+      assert.equal(variableNode1.startIndex, 8);
+      assert.equal(variableNode2.startIndex, 14);
+      assert.equal(variableNode2.endIndex, 17);
+    });
+
+    it("keeps nodes up to date across many edits", () => {
+      input = 'abc + cde';
+      tree = parser.parse(input);
+      const variableNode = tree.rootNode.firstChild.firstChild.lastChild;
+
+      for (let i = 0; i < 3000; i++) {
+        ([input, edit] = spliceInput(input, 0, 0, ' '));
+        tree.edit(edit);
+        if (i === 1500) assert.equal(variableNode.startIndex, 6 + 1501);
+      }
+      assert.equal(variableNode.startIndex, 6 + 3000);
+      assert.equal(variableNode.startPosition.column, 6 + 3000);
+    });
+  });
+
+  describe('.editMany()', () => {
+    it('applies packed edits in order', () => {
+      let input = 'abc + cde';
+      const tree = parser.parse(input);
+      const variableNode = tree.rootNode.firstChild.firstChild.lastChild;
+      const expected = parser.parse(input);
+
+      const edits = [];
+      for (const [index, text] of [[0, 'x + '], [4, 'y * '], [0, '\n']]) {
+        let edit;
+        ([input, edit] = spliceInput(input, index, 0, text));
+        expected.edit(edit);
+        edits.push(
+          edit.startIndex, edit.oldEndIndex, edit.newEndIndex,
+          edit.startPosition.row, edit.startPosition.column,
+          edit.oldEndPosition.row, edit.oldEndPosition.column,
+          edit.newEndPosition.row, edit.newEndPosition.column
+        );
+      }
+      assert.equal(edits.length, 3 * Parser.Tree.EDIT_STRIDE);
+
+      tree.editMany(Int32Array.from(edits));
+      assert.equal(variableNode.startIndex, input.indexOf('cde'));
+      assert.equal(
+        parser.parse(input, tree).rootNode.toString(),
+        parser.parse(input, expected).rootNode.toString()
+      );
+    });
+
+    it('rejects arrays that are not made of whole edits', () => {
+      const tree = parser.parse('abc');
+      assert.throws(() => tree.editMany(new Int32Array(8)), RangeError);
+      assert.throws(() => tree.editMany([0, 0, 0, 0, 0, 0, 0, 0, 0]), TypeError);
+    });
+
+    it('applies none of the edits when one of them is invalid', () => {
+      const tree = parser.parse('abc + cde', null, {keepText: true});
+      const [input, first] = spliceInput('abc + cde', 0, 3, 'xy');
+      const [, second] = spliceInput(input, 0, 0, 'z');
+      const edits = Int32Array.from([first, second].flatMap(edit => [
+        edit.startIndex, edit.oldEndIndex, edit.newEndIndex,
+        edit.startPosition.row, edit.startPosition.column,
+        edit.oldEndPosition.row, edit.oldEndPosition.column,
+        edit.newEndPosition.row, edit.newEndPosition.column
+      ]));
+
+      assert.throws(() => tree.editMany(edits, ['xy', 'zz']), RangeError);
+      assert.equal(tree.rootNode.endIndex, 9);
+    });
+  });
+
+  describe('keepText', () => {
+    it('serves node text from the text kept by the tree', () => {
+      const lines = ['let x = 1;', 'console.log(x);'];
+      let reads = 0;
+      const tree = parser.parse((index, position) => {
+        reads++;
+        const line = lines[position.row];
+        if (line != null) return line.slice(position.column) + '\n';
+      }, null, {keepText: true});
+      const readsAfterParse = reads;
+
+      assert.isTrue(tree.hasText);
+      assert.equal(tree.rootNode.firstChild.text, 'let x = 1;');
+      assert.equal(tree.getTextRange(11, 22), 'console.log');
+      assert.equal(reads, readsAfterParse);
+    });
+
+    it('splices the text supplied with edits', () => {
+      let input = 'abc + cde';
+      const tree = parser.parse(Buffer.from(input), null, {keepText: true});
+      const variableNode = tree.rootNode.firstChild.firstChild.lastChild;
+
+      let edit;
+      ([input, edit] = spliceInput(input, 0, 3, 'xy'));
+      tree.edit(edit, 'xy');
+      assert.equal(tree.getTextRange(0, input.length), 'xy + cde');
+      assert.equal(variableNode.text, 'cde');
+
+      const query = new Parser.Query(JavaScript, '((identifier) @id (#eq? @id "xy"))');
+      const newTree = parser.parse(Buffer.from(input), tree, {keepText: true});
+      assert.equal(query.captures(newTree.rootNode).length, 1);
+
+      ([input, edit] = spliceInput(input, 0, 0, ' '));
+      tree.edit(edit);
+      assert.isFalse(tree.hasText);
+      assert.isUndefined(tree.getTextRange(0, 1));
+    });
+
+    it('rejects edit text that does not match the edit', () => {
+      const tree = parser.parse('abc', null, {keepText: true});
+      const [, edit] = spliceInput('abc', 0, 1, 'xy');
+      assert.throws(() => tree.edit(edit, 'x'), RangeError);
+      assert.equal(tree.getTextRange(0, 3), 'abc');
+    });
+
+    it('keeps the text unchanged when a batch of edits is rejected', () => {
+      const tree = parser.parse('abc + cde', null, {keepText: true});
+      const variableNode = tree.rootNode.firstChild.firstChild.lastChild;
+      const [input, first] = spliceInput('abc + cde', 0, 3, 'xy');
+      const [, second] = spliceInput(input, 5, 0, 'z');
+      const edits = Int32Array.from([first, second].flatMap(edit => [
+        edit.startIndex, edit.oldEndIndex, edit.newEndIndex,
+        edit.startPosition.row, edit.startPosition.column,
+        edit.oldEndPosition.row, edit.oldEndPosition.column,
+        edit.newEndPosition.row, edit.newEndPosition.column
+      ]));
+
+      assert.throws(() => tree.editMany(edits, ['xy', 5]), TypeError);
+      assert.isTrue(tree.hasText);
+      assert.equal(tree.getTextRange(0, 9), 'abc + cde');
+      assert.equal(variableNode.text, 'cde');
+
+      tree.editMany(edits, ['xy', 'z']);
+      assert.equal(tree.getTextRange(0, 9), 'xy + zcde');
+      assert.equal(variableNode.text, 'cde');
+    });
+  });
+
+  describe('.toFlatArrays()', () => {
+    it('exports every node in pre-order', () => {
+      const tree = parser.parse('a(b, "ĉ");');
+      const flat = tree.toFlatArrays();
+      const {NAMED} = Parser.Tree.FLAT_NODE_FLAGS;
+      const NONE = 0xFFFFFFFF;
+
+      const nodes = [];
+      const fieldNames = [];
+      const cursor = tree.walk();
+      do {
+        nodes.push(cursor.currentNode);
+        fieldNames.push(cursor.currentFieldName);
+      } while (cursor.gotoFirstChild() || gotoNext(cursor));
+
+      const index = node => node ? nodes.indexOf(node) : NONE;
+      assert.equal(flat.length, nodes.length);
+      nodes.forEach((node, i) => {
+        assert.equal(flat.typeId[i], node.typeId);
+        assert.equal(flat.startIndex[i], node.startIndex);
+        assert.equal(flat.endIndex[i], node.endIndex);
+        assert.equal(flat.startColumn[i], node.startPosition.column);
+        assert.equal(flat.endColumn[i], node.endPosition.column);
+        assert.equal(Boolean(flat.flags[i] & NAMED), node.isNamed);
+        assert.equal(flat.parent[i], index(node.parent));
+        assert.equal(flat.firstChild[i], index(node.firstChild));
+        assert.equal(flat.nextSibling[i], index(node.nextSibling));
+        assert.equal(flat.fieldId[i] !== 0, Boolean(fieldNames[i]));
+      });
+    });
+
+    it('reports errors and missing nodes', () => {
+      const tree = parser.parse('a(b c');
+      const flat = tree.toFlatArrays();
+      const {ERROR, MISSING, HAS_ERROR} = Parser.Tree.FLAT_NODE_FLAGS;
+      assert.isTrue(Boolean(flat.flags[0] & HAS_ERROR));
+      assert.isTrue(flat.flags.some(flags => flags & (ERROR | MISSING)));
+    });
+  });
+
+  describe('.serialize()', () => {
+    const source = 'function a(b) { return c(b, "ĉ"); }';
+
+    it('can be loaded as a FlatTree with the same structure', () => {
+      const tree = parser.parse(source);
+      const flatTree = new Parser.FlatTree(tree.serialize(), JavaScript);
+      assert.equal(flatTree.length, tree.toFlatArrays().length);
+      assert.equal(flatTree.encoding, 'utf16');
+      assertSameStructure(flatTree.rootNode, tree.rootNode);
+
+      const call = flatTree.descendantForIndex(source.indexOf('c('));
+      assert.equal(call.type, 'identifier');
+      assert.equal(call.parent.type, 'call_expression');
+      assert.equal(call.parent.childForFieldName('arguments').type, 'arguments');
+      assert.equal(call.nextSibling.previousSibling.index, call.index);
+      assert.equal(
+        flatTree.namedDescendantForIndex(source.indexOf('(b,')).type,
+        'arguments'
+      );
+      assert.deepEqual(
+        flatTree.descendantsOfType('identifier').map(node => source.slice(node.startIndex, node.endIndex)),
+        ['a', 'b', 'c', 'b']
+      );
+    });
+
+    it('can be memory-mapped from a file', () => {
+      const tree = parser.parse(Buffer.from(source));
+      const path = require('path').join(require('os').tmpdir(), `tree-sitter-test-${process.pid}.bin`);
+      fs.writeFileSync(path, tree.serialize());
+      try {
+        const flatTree = Parser.FlatTree.mapFile(path, JavaScript);
+        assert.equal(flatTree.encoding, 'utf8');
+        assertSameStructure(flatTree.rootNode, tree.rootNode);
+
+        // Writes go to private copies of the pages, not to the file.
+        const typeId = flatTree.typeId[0];
+        flatTree.typeId[0] = typeId + 1;
+        assert.equal(flatTree.typeId[0], typeId + 1);
+        assert.equal(Parser.FlatTree.mapFile(path, JavaScript).typeId[0], typeId);
+      } finally {
+        fs.unlinkSync(path);
+      }
+    });
+
+    it('rejects snapshots that are corrupt or from another grammar', () => {
+      const snapshot = parser.parse(source).serialize();
+      assert.throws(() => new Parser.FlatTree(snapshot.subarray(4), JavaScript), /Invalid/);
+      assert.throws(() => new Parser.FlatTree(snapshot.subarray(0, 40), JavaScript), /Truncated/);
+
+      const other = Buffer.from(snapshot);
+      other.writeUInt32LE(other.readUInt32LE(24) ^ 1, 24);
+      assert.throws(() => new Parser.FlatTree(other, JavaScript), /different language/);
+    });
+  });
+
+  describe('.traverse()', () => {
+    const source = 'function a(b) { return c(b, d => "e"); }';
+
+    it('visits the nodes of the given types in document order', () => {
+      const tree = parser.parse(source);
+      const events = [];
+      tree.traverse({
+        types: ['identifier', 'arrow_function'],
+        batchSize: 2,
+        enter: (node, depth) => events.push(['enter', node.type, node.text, depth]),
+        leave: (node, depth) => events.push(['leave', node.type, node.text, depth]),
+      });
+      assert.deepEqual(events.filter(([kind]) => kind === 'enter').map(event => event[2]), [
+        'a', 'b', 'c', 'b', 'd => "e"', 'd'
+      ]);
+
+      const arrow = events.findIndex(event => event[1] === 'arrow_function');
+      const depth = events[arrow][3];
+      assert.deepEqual(events.slice(arrow), [
+        ['enter', 'arrow_function', 'd => "e"', depth],
+        ['enter', 'identifier', 'd', depth + 1],
+        ['leave', 'identifier', 'd', depth + 1],
+        ['leave', 'arrow_function', 'd => "e"', depth],
+      ]);
+    });
+
+    it('matches a cursor walk when unfiltered', () => {
+      const tree = parser.parse(source);
+      const expected = [];
+      const cursor = tree.walk();
+      do {
+        if (cursor.nodeIsNamed) expected.push(cursor.currentNode);
+      } while (cursor.gotoFirstChild() || gotoNext(cursor));
+
+      const visited = [];
+      tree.traverse({namedOnly: true, enter: node => visited.push(node)});
+      assert.deepEqual(visited.map(node => node.type), expected.map(node => node.type));
+      assert.deepEqual(visited.map(node => node.startIndex), expected.map(node => node.startIndex));
+    });
+
+    it('does not descend below maxDepth', () => {
+      const tree = parser.parse(source);
+      const depths = [];
+      tree.traverse({maxDepth: 1, enter: (node, depth) => depths.push(depth)});
+      assert.deepEqual(depths, [0, 1]);
+    });
+
+    it('propagates exceptions thrown by the callbacks', () => {
+      const tree = parser.parse(source);
+      let count = 0;
+      assert.throws(() => tree.traverse({
+        batchSize: 1,
+        enter() { if (++count === 3) throw new Error('stop'); }
+      }), 'stop');
+      assert.equal(count, 3);
+    });
+
+    it('rejects edits made by the callbacks', () => {
+      const tree = parser.parse(source);
+      const [, edit] = spliceInput(source, 0, 0, ' ');
+      let count = 0;
+      tree.traverse({
+        batchSize: 1,
+        enter() {
+          count++;
+          assert.throws(() => tree.edit(edit), /traversed/);
+          assert.throws(() => tree.editMany(new Int32Array(Parser.Tree.EDIT_STRIDE)), /traversed/);
+        }
+      });
+      assert.isAbove(count, 1);
+      assert.equal(tree.rootNode.startIndex, 0);
+
+      tree.edit(edit);
+      assert.equal(tree.rootNode.endIndex, source.length + 1);
+    });
   });
 
   describe('.getEditedRange()', () => {
@@ -317,6 +640,69 @@ describe("Tree", () => {
       assert(cursor.gotoParent());
       assert(!cursor.gotoParent());
     })
+
+    it('returns a cursor that can move backwards and by descendant index', () => {
+      const tree = parser.parse('a * b + c / d');
+      const cursor = tree.walk();
+      assert.equal(cursor.descendantIndex, 0);
+
+      cursor.gotoFirstChild();
+      cursor.gotoFirstChild();
+      assert(cursor.gotoLastChild());
+      assert.equal(cursor.nodeType, 'binary_expression');
+      assert.equal(cursor.startIndex, 8);
+      assert.equal(cursor.currentFieldName, 'right');
+      assert.equal(cursor.descendantIndex, 8);
+
+      assert(cursor.gotoPreviousSibling());
+      assert.equal(cursor.nodeType, '+');
+      assert(cursor.gotoPreviousSibling());
+      assert.equal(cursor.currentFieldName, 'left');
+      assert.equal(cursor.descendantIndex, 3);
+      assert(!cursor.gotoPreviousSibling());
+      assert.equal(cursor.startIndex, 0);
+
+      const other = tree.walk();
+      other.resetTo(cursor);
+      assert(other.gotoFirstChild());
+      assert.equal(other.nodeText, 'a');
+      assert.equal(cursor.nodeType, 'binary_expression');
+
+      assert(cursor.gotoDescendant(11));
+      assert.equal(cursor.nodeText, 'd');
+      assert.equal(cursor.descendantIndex, 11);
+      assert(!cursor.gotoDescendant(12));
+      assert.equal(cursor.descendantIndex, 11);
+      assert(cursor.gotoParent());
+      assert.equal(cursor.startIndex, 8);
+    });
+
+    it('returns a cursor that can collect nodes in batches', () => {
+      const tree = parser.parse('a * b + c / d');
+      const stride = Parser.TreeCursor.COLLECT_STRIDE;
+      const cursor = tree.walk();
+
+      const first = cursor.collect(5);
+      assert.equal(first.length, 5 * stride);
+      assert.deepEqual(Array.from(first.subarray(0, stride)), [0, tree.rootNode.typeId, 0, 0, 13]);
+      const [depth, typeId, fieldId, startIndex, endIndex] = first.subarray(4 * stride);
+      assert.deepEqual([depth, startIndex, endIndex], [4, 0, 1]);
+      assert.equal(typeId, tree.rootNode.descendantForIndex(0).typeId);
+      assert.notEqual(fieldId, 0);
+      assert.equal(cursor.nodeType, '*');
+
+      const rest = cursor.collect(100);
+      assert.equal(rest.length, 7 * stride);
+      assert.equal(cursor.nodeType, 'program');
+      assert.equal(cursor.collect(100).length, 0);
+
+      cursor.reset(tree.rootNode);
+      const identifiers = cursor.collect(100, {types: 'identifier'});
+      assert.deepEqual(
+        Array.from({length: identifiers.length / stride}, (_, i) => identifiers[i * stride + 3]),
+        [0, 4, 8, 12]
+      );
+    });
   });
 });
 
@@ -368,3 +754,21 @@ function getExtent(text) {
   }
   return {row, column: text.length - index};
 }
+
+function gotoNext(cursor) {
+  while (!cursor.gotoNextSibling()) {
+    if (!cursor.gotoParent()) return false;
+  }
+  return true;
+}
+
+function assertSameStructure(flatNode, node) {
+  assert.equal(flatNode.type, node.type);
+  assert.equal(flatNode.isNamed, node.isNamed);
+  assert.equal(flatNode.startIndex, node.startIndex);
+  assert.equal(flatNode.endIndex, node.endIndex);
+  assert.deepEqual(flatNode.startPosition, node.startPosition);
+  assert.deepEqual(flatNode.endPosition, node.endPosition);
+  assert.equal(flatNode.childCount, node.childCount);
+  flatNode.children.forEach((child, i) => assertSameStructure(child, node.children[i]));
+}
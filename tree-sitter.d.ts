@@ -1,11 +1,23 @@
 declare module "tree-sitter" {
   class Parser {
-    parse(input: string | Parser.Input | Parser.InputReader, oldTree?: Parser.Tree, options?: { bufferSize?: number, includedRanges?: Parser.Range[] }): Parser.Tree;
+    parse(input: string | Buffer | Uint8Array | Parser.Input | Parser.InputReader, oldTree?: Parser.Tree, options?: Parser.ParseOptions): Parser.Tree | null;
+    parseAsync(input: string | Buffer | Uint8Array | Parser.InputReader, oldTree?: Parser.Tree, options?: Parser.ParseOptions): Promise<Parser.Tree | null>;
+    reparse(tree: Parser.Tree, edits: Parser.Edit[] | Int32Array | Uint32Array, input: string | Buffer | Uint8Array | Parser.InputReader, options?: Parser.ParseOptions): Parser.ReparseResult | null;
     getLanguage(): any;
     setLanguage(language: any): void;
     getLogger(): Parser.Logger;
-    setLogger(logFunc: Parser.Logger): void;
+    setLogger(logFunc: Parser.Logger | false | null): void;
+    setLogBuffer(options?: Parser.LogBufferOptions): Parser;
+    drainLog(options?: {raw?: false}): Parser.LogRecord[] | null;
+    drainLog(options: {raw: true}): Buffer | null;
+    stats(): Parser.ParserStats;
     printDotGraphs(enabled: boolean): void;
+    setCountNewNodes(enabled: boolean): Parser;
+    reset(): void;
+
+    static readonly CHANGED_RANGE_STRIDE: number;
+
+    static parseMany(jobs: Parser.ParseJob[], options?: Parser.ParseManyOptions): Promise<Array<Parser.Tree | null>>;
   }
 
   namespace Parser {
@@ -30,12 +42,71 @@ declare module "tree-sitter" {
       newEndPosition: Point;
     };
 
+    export type ParseOptions = {
+      bufferSize?: number,
+      includedRanges?: Range[],
+      encoding?: 'utf8' | 'utf16',
+      timeoutMicros?: number,
+      cancellationFlag?: Int32Array | BigInt64Array | Uint32Array | BigUint64Array,
+      keepText?: boolean
+    };
+
+    export type ReparseResult = {
+      tree: Tree,
+      changedRanges: Uint32Array
+    };
+
+    export type ParseStats = {
+      wallTime: number,
+      cpuTime: number,
+      callbackTime: number,
+      bytesRead: number,
+      readCount: number
+    };
+
+    export type ParserStats = ParseStats & {
+      parseCount: number,
+      incrementalParseCount: number,
+      newNodeCount: number
+    };
+
+    export type TreeParseStats = ParseStats & {
+      incremental: boolean,
+      nodeCount: number,
+      newNodeCount: number | null,
+      reusedNodeCount: number | null
+    };
+
+    export type ParseJob = {
+      input: string | Buffer | Uint8Array | InputReader,
+      language: any,
+      oldTree?: Tree,
+      encoding?: 'utf8' | 'utf16'
+    };
+
+    export type ParseManyOptions = {
+      concurrency?: number,
+      timeoutMicros?: number,
+      onFile?: (index: number, error: Error | null, tree: Tree | null) => void
+    };
+
     export type Logger = (
       message: string,
       params: {[param: string]: string},
       type: "parse" | "lex"
     ) => void;
 
+    export type LogBufferOptions = {
+      capacity?: number,
+      types?: Array<"parse" | "lex">,
+      sampleInterval?: number
+    };
+
+    export type LogRecord = {
+      type: "parse" | "lex",
+      message: string
+    };
+
     export interface InputReader {
       (index: any, position: Point): string;
     }
@@ -86,9 +157,11 @@ declare module "tree-sitter" {
       descendantForPosition(startPosition: Point, endPosition: Point): SyntaxNode;
       namedDescendantForPosition(position: Point): SyntaxNode;
       namedDescendantForPosition(startPosition: Point, endPosition: Point): SyntaxNode;
-      descendantsOfType(types: String | Array<String>, startPosition?: Point, endPosition?: Point): Array<SyntaxNode>;
+      descendantsOfType(types: String | Array<String> | NodeTypeSet, startPosition?: Point, endPosition?: Point): Array<SyntaxNode>;
 
-      closest(types: String | Array<String>): SyntaxNode | null;
+      closest(types: String | Array<String> | NodeTypeSet): SyntaxNode | null;
+      select(selector: string | Selector): Array<SyntaxNode>;
+      selectFirst(selector: string | Selector): SyntaxNode | null;
       walk(): TreeCursor;
     }
 
@@ -103,22 +176,124 @@ declare module "tree-sitter" {
       endIndex: number;
       readonly currentNode: SyntaxNode;
       readonly currentFieldName: string;
+      readonly descendantIndex: number;
 
       reset(node: SyntaxNode): void
+      resetTo(cursor: TreeCursor): void;
       gotoParent(): boolean;
       gotoFirstChild(): boolean;
+      gotoLastChild(): boolean;
       gotoFirstChildForIndex(index: number): boolean;
       gotoNextSibling(): boolean;
+      gotoPreviousSibling(): boolean;
+      gotoDescendant(index: number): boolean;
+      collect(maxNodes: number, filter?: {types?: string | string[] | NodeTypeSet, namedOnly?: boolean}): Uint32Array;
     }
 
     export interface Tree {
       readonly rootNode: SyntaxNode;
+      readonly hasText: boolean;
+      readonly parseStats: TreeParseStats | null;
 
-      edit(delta: Edit): Tree;
+      edit(delta: Edit, newText?: string | Buffer): Tree;
+      editMany(edits: Int32Array | Uint32Array, newTexts?: Array<string | Buffer>): Tree;
+      getTextRange(startIndex: number, endIndex: number): string | undefined;
       walk(): TreeCursor;
       getChangedRanges(other: Tree): Range[];
       getEditedRange(other: Tree): Range;
       printDotGraph(): void;
+      toFlatArrays(): FlatArrays;
+      serialize(): Buffer;
+      traverse(options: TraverseOptions): void;
+    }
+
+    export type TraverseOptions = {
+      enter?: (node: SyntaxNode, depth: number) => void,
+      leave?: (node: SyntaxNode, depth: number) => void,
+      types?: string | string[] | NodeTypeSet,
+      namedOnly?: boolean,
+      maxDepth?: number,
+      batchSize?: number
+    };
+
+    export class Selector {
+      constructor(language: any, selector: string);
+    }
+
+    // A grammar's language object. Once tree-sitter has seen it, it also has
+    // a `typeSet` method that compiles node type names into a NodeTypeSet.
+    export interface Language {
+      nodeTypeInfo?: any;
+      typeSet(types: string | string[]): NodeTypeSet;
+      [key: string]: any;
+    }
+
+    export class NodeTypeSet {
+      constructor(language: any, types: string | string[]);
+
+      readonly language: Language;
+      readonly bits: Uint8Array;
+
+      has(typeId: number): boolean;
+    }
+
+    export class FlatTree {
+      constructor(snapshot: Buffer | Uint8Array, language: any);
+      static mapFile(path: string, language: any): FlatTree;
+
+      readonly language: any;
+      readonly encoding: 'utf8' | 'utf16';
+      readonly length: number;
+      readonly rootNode: FlatNode;
+
+      descendantForIndex(startIndex: number, endIndex?: number): FlatNode;
+      namedDescendantForIndex(startIndex: number, endIndex?: number): FlatNode;
+      descendantsOfType(types: string | string[] | NodeTypeSet, startPosition?: Point, endPosition?: Point): FlatNode[];
+    }
+
+    export interface FlatNode {
+      readonly tree: FlatTree;
+      readonly index: number;
+      readonly typeId: number;
+      readonly type: string;
+      readonly isNamed: boolean;
+      readonly isMissing: boolean;
+      readonly hasError: boolean;
+      readonly startIndex: number;
+      readonly endIndex: number;
+      readonly startPosition: Point;
+      readonly endPosition: Point;
+      readonly parent: FlatNode | null;
+      readonly children: Array<FlatNode>;
+      readonly namedChildren: Array<FlatNode>;
+      readonly childCount: number;
+      readonly namedChildCount: number;
+      readonly firstChild: FlatNode | null;
+      readonly lastChild: FlatNode | null;
+      readonly nextSibling: FlatNode | null;
+      readonly previousSibling: FlatNode | null;
+
+      childForFieldName(fieldName: string): FlatNode | null;
+      childrenForFieldName(fieldName: string): Array<FlatNode>;
+      descendantForIndex(startIndex: number, endIndex?: number): FlatNode;
+      namedDescendantForIndex(startIndex: number, endIndex?: number): FlatNode;
+      descendantsOfType(types: string | string[] | NodeTypeSet, startPosition?: Point, endPosition?: Point): FlatNode[];
+    }
+
+    export interface FlatArrays {
+      length: number;
+      typeId: Uint32Array;
+      fieldId: Uint32Array;
+      startIndex: Uint32Array;
+      endIndex: Uint32Array;
+      startRow: Uint32Array;
+      startColumn: Uint32Array;
+      endRow: Uint32Array;
+      endColumn: Uint32Array;
+      parent: Uint32Array;
+      firstChild: Uint32Array;
+      nextSibling: Uint32Array;
+      flags: Uint32Array;
     }
 
     export interface QueryMatch {
@@ -135,7 +310,21 @@ declare module "tree-sitter" {
       refutedProperties?: {[prop: string]: string | null},
     }
 
+    export type QueryIterOptions = {
+      startIndex?: number,
+      endIndex?: number,
+      matchLimit?: number,
+      batchSize?: number
+    };
+
+    export interface QueryMatchIterator extends IterableIterator<QueryMatch> {
+      readonly didExceedMatchLimit: boolean;
+    }
+
     export class Query {
+      static readonly RAW_CAPTURE_STRIDE: number;
+
+      readonly captureNames: string[];
       readonly predicates: { [name: string]: Function }[];
       readonly setProperties: any[];
       readonly assertedProperties: any[];
@@ -145,6 +334,8 @@ declare module "tree-sitter" {
 
       matches(rootNode: SyntaxNode, startPosition?: Point, endPosition?: Point): QueryMatch[];
       captures(rootNode: SyntaxNode, startPosition?: Point, endPosition?: Point): QueryCapture[];
+      iterMatches(rootNode: SyntaxNode, options?: QueryIterOptions): QueryMatchIterator;
+      rawCaptures(rootNode: SyntaxNode, options?: {startIndex?: number, endIndex?: number}): Uint32Array;
     }
   }
 